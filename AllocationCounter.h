@@ -0,0 +1,87 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Global heap allocation counter.
+// Build with -DCOUNT_EVENT_ALLOCATIONS to replace the whole operator new/delete
+// family (plain, array, nothrow, sized and aligned forms) with counting versions,
+// so the event loop can check that reconstruction stays allocation-free in steady
+// state. Without the flag heapAllocationsCounted() is false, heapAllocations() is
+// 0 and nothing is replaced. Include from exactly one translation unit.
+#ifdef COUNT_EVENT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+std::atomic<long> g_heapAllocations(0);
+
+// Every new form ends up here; returns nullptr on failure
+inline void *countedAlloc(std::size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+inline void *countedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t alignment = static_cast<std::size_t>(align);
+    if (alignment < sizeof(void *)) alignment = sizeof(void *);
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size ? size : 1) != 0) return nullptr;
+    return ptr;
+}
+
+void *operator new(std::size_t size) {
+    if (void *ptr = countedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) {
+    if (void *ptr = countedAlloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return countedAlloc(size); }
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    if (void *ptr = countedAlignedAlloc(size, align)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t size, std::align_val_t align) {
+    if (void *ptr = countedAlignedAlloc(size, align)) return ptr;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+
+// malloc and posix_memalign memory are both released with free. Kept out of
+// line so GCC does not pair an inlined free with operator new and warn
+// (-Wmismatched-new-delete).
+__attribute__((noinline)) void countedFree(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(ptr); }
+
+inline bool heapAllocationsCounted() { return true; }
+inline long heapAllocations() { return g_heapAllocations.load(std::memory_order_relaxed); }
+
+#else
+
+inline bool heapAllocationsCounted() { return false; }
+inline long heapAllocations() { return 0; }
+
+#endif
+
+#endif
@@ -0,0 +1,480 @@
+#ifndef ANALYSIS_CONFIG_H
+#define ANALYSIS_CONFIG_H
+
+#include "EventKernel.h"
+#include "SelectionConfig.h"
+#include "CutFlow.h"
+#include "SelectionProcessor.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Everything the analysis reads from a configuration file. The built-in
+// defaults reproduce MichelElectronAnalysisFinal; the variant programs are
+// selections (see SelectionConfig).
+struct AnalysisConfig {
+    double pulseThreshold;              // ADC threshold for pulse detection
+    double baselineUncertainty;         // Baseline uncertainty (ADC)
+    double latePulseThreshold;          // PMT pulse runs past the window if last sample > this (ADC)
+    int latePulseMinPmts;               // PMTs with late pulses for the relaxed muon criterion
+    int adcSaturation;                  // Digitizer full scale (ADC code)
+    double baselineTolerance;           // Stored baseline overridden if off by more than this (ADC)
+    double baselineQuietSpread;         // Max pre-pulse spread for a baseline update (ADC)
+    double noiseThresholdSigmas;        // Noise-adaptive pulse threshold in units of baselineRMS
+    double pmtHitThreshold[N_PMTS];     // Min pulse energy for a PMT hit (p.e.)
+    std::vector<int> calibrationTriggers; // Trigger codes for gain monitoring only
+    std::vector<int> muonOnlyTriggers;  // Trigger codes excluded from the Michel search
+    double fitMin;                      // Michel dt fit range (µs)
+    double fitMax;
+    std::vector<double> fitScanStarts;  // Fit start times compared by chi2/NDF, none to skip (µs)
+    double fitScanEnd;                  // End of every scan fit (µs)
+    std::vector<SelectionConfig> selections; // Cut configurations, the first one plotted
+    std::vector<DelayedWindowConfig> windows; // Delayed windows searched in every selection
+};
+
+// Call v(key, field) for every global setting, in file order. The parser
+// and the writer both go through here, so the key list exists only once.
+template <class V>
+void visitGlobalSettings(AnalysisConfig &c, V &v) {
+    v("pulse_threshold", c.pulseThreshold);
+    v("baseline_uncertainty", c.baselineUncertainty);
+    v("late_pulse_threshold", c.latePulseThreshold);
+    v("late_pulse_min_pmts", c.latePulseMinPmts);
+    v("adc_saturation", c.adcSaturation);
+    v("baseline_tolerance", c.baselineTolerance);
+    v("baseline_quiet_spread", c.baselineQuietSpread);
+    v("noise_threshold_sigmas", c.noiseThresholdSigmas);
+    v("pmt_hit_thresholds", c.pmtHitThreshold);
+    v("calibration_triggers", c.calibrationTriggers);
+    v("muon_only_triggers", c.muonOnlyTriggers);
+    v("fit_min", c.fitMin);
+    v("fit_max", c.fitMax);
+    v("fit_scan_starts", c.fitScanStarts);
+    v("fit_scan_end", c.fitScanEnd);
+}
+
+template <class V>
+void visitSelectionSettings(SelectionConfig &s, V &v) {
+    v("ev61_threshold", s.ev61Threshold);
+    v("veto_convention", s.vetoConvention);
+    v("multiplicity", s.multiplicity);
+    v("muon_cuts", s.muonCuts);
+    v("michel_cuts", s.michelCuts);
+    v("michel_energy_max_dt", s.michelEnergyMaxDt);
+    v("michel_dt_min", s.michelDtMin);
+    v("michel_dt_max", s.michelDtMax);
+    v("muon_dead_time", s.muonDeadTime);
+    v("panel_thresholds", s.panelThreshold);
+    v("top_sum_threshold", s.topSumThreshold);
+    v("michel_energy_bins", s.michelEnergyBins);
+    v("dt_bins", s.dtBins);
+    v("energy_vs_dt_max_dt", s.energyVsDtMaxDt);
+    v("energy_vs_dt_max_energy", s.energyVsDtMaxEnergy);
+    v("energy_vs_dt_fill", s.energyVsDtFill);
+}
+
+template <class V>
+void visitWindowSettings(DelayedWindowConfig &w, V &v) {
+    v("cuts", w.cuts);
+    v("dt_min", w.dtMin);
+    v("dt_max", w.dtMax);
+    v("energy_bins", w.energyBins);
+    v("max_energy", w.maxEnergy);
+    v("dt_bins", w.dtBins);
+}
+
+// Shortest of %.15g and %.17g that reads back as the same double
+inline std::string formatConfigNumber(double x) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", x);
+    if (std::strtod(buffer, nullptr) != x) std::snprintf(buffer, sizeof(buffer), "%.17g", x);
+    return buffer;
+}
+
+// Sets the field named key from its text, if this is the one
+struct ConfigFieldParser {
+    std::string key;
+    std::string value;
+    bool matched;
+    std::string error;
+
+    static bool parseNumber(const std::string &text, double &x) {
+        char *end = nullptr;
+        x = std::strtod(text.c_str(), &end);
+        return !text.empty() && *end == '\0';
+    }
+
+    static std::vector<std::string> split(const std::string &text) {
+        std::vector<std::string> items;
+        std::string item;
+        std::istringstream in(text);
+        while (in >> item) items.push_back(item);
+        return items;
+    }
+
+    void operator()(const char *name, double &x) {
+        if (key != name) return;
+        matched = true;
+        if (!parseNumber(value, x)) error = "'" + value + "' is not a number";
+    }
+
+    void operator()(const char *name, int &x) {
+        if (key != name) return;
+        matched = true;
+        double d;
+        if (!parseNumber(value, d) || d != static_cast<int>(d)) {
+            error = "'" + value + "' is not an integer";
+        } else {
+            x = static_cast<int>(d);
+        }
+    }
+
+    template <int N>
+    void operator()(const char *name, double (&x)[N]) {
+        if (key != name) return;
+        matched = true;
+        std::vector<std::string> items = split(value);
+        if (static_cast<int>(items.size()) != N) {
+            error = "expected " + std::to_string(N) + " values, got " + std::to_string(items.size());
+            return;
+        }
+        for (int i = 0; i < N; i++) {
+            if (!parseNumber(items[i], x[i])) error = "'" + items[i] + "' is not a number";
+        }
+    }
+
+    void operator()(const char *name, std::vector<int> &x) {
+        if (key != name) return;
+        matched = true;
+        x.clear();
+        for (const std::string &item : split(value)) {
+            double d;
+            if (!parseNumber(item, d) || d != static_cast<int>(d)) {
+                error = "'" + item + "' is not an integer";
+                return;
+            }
+            x.push_back(static_cast<int>(d));
+        }
+    }
+
+    void operator()(const char *name, std::vector<double> &x) {
+        if (key != name) return;
+        matched = true;
+        x.clear();
+        for (const std::string &item : split(value)) {
+            double d;
+            if (!parseNumber(item, d)) {
+                error = "'" + item + "' is not a number";
+                return;
+            }
+            x.push_back(d);
+        }
+    }
+
+    void operator()(const char *name, std::string &x) {
+        if (key != name) return;
+        matched = true;
+        x = value;
+    }
+};
+
+// Appends "key = value" lines
+struct ConfigFieldWriter {
+    std::ostringstream out;
+
+    void operator()(const char *name, double x) { out << name << " = " << formatConfigNumber(x) << "\n"; }
+    void operator()(const char *name, int x) { out << name << " = " << x << "\n"; }
+    void operator()(const char *name, const std::string &x) { out << name << " = " << x << "\n"; }
+
+    template <int N>
+    void operator()(const char *name, const double (&x)[N]) {
+        out << name << " =";
+        for (int i = 0; i < N; i++) out << " " << formatConfigNumber(x[i]);
+        out << "\n";
+    }
+
+    void operator()(const char *name, const std::vector<int> &x) {
+        out << name << " =";
+        for (int code : x) out << " " << code;
+        out << "\n";
+    }
+
+    void operator()(const char *name, const std::vector<double> &x) {
+        out << name << " =";
+        for (double value : x) out << " " << formatConfigNumber(value);
+        out << "\n";
+    }
+};
+
+// Canonical text of a configuration: every setting, in a fixed order, with
+// exact numbers. It reads back as the same configuration, and its hash
+// identifies the configuration whatever the layout of the original file.
+inline std::string analysisConfigText(const AnalysisConfig &config) {
+    AnalysisConfig copy = config;
+    ConfigFieldWriter writer;
+    visitGlobalSettings(copy, writer);
+    for (SelectionConfig &selection : copy.selections) {
+        writer.out << "\n[selection " << selection.name << "]\n";
+        visitSelectionSettings(selection, writer);
+    }
+    for (DelayedWindowConfig &window : copy.windows) {
+        writer.out << "\n[window " << window.name << "]\n";
+        visitWindowSettings(window, writer);
+    }
+    return writer.out.str();
+}
+
+// 64-bit FNV-1a
+inline uint64_t configHash(const std::string &text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char ch : text) {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline std::string configHashString(uint64_t hash) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+// Check ranges and cross-field consistency; false and a message on the first problem
+inline bool validateAnalysisConfig(const AnalysisConfig &c, std::string &error) {
+    if (c.pulseThreshold <= 0 || c.baselineUncertainty < 0) {
+        error = "pulse_threshold must be positive and baseline_uncertainty not negative";
+        return false;
+    }
+    if (c.latePulseMinPmts < 1 || c.latePulseMinPmts > N_PMTS) {
+        error = "late_pulse_min_pmts must be between 1 and " + std::to_string(N_PMTS);
+        return false;
+    }
+    if (c.adcSaturation <= 0 || c.baselineTolerance <= 0 || c.baselineQuietSpread <= 0 || c.noiseThresholdSigmas < 0) {
+        error = "adc_saturation, baseline_tolerance and baseline_quiet_spread must be positive, noise_threshold_sigmas not negative";
+        return false;
+    }
+    for (int i = 0; i < N_PMTS; i++) {
+        if (c.pmtHitThreshold[i] < 0) {
+            error = "pmt_hit_thresholds must not be negative";
+            return false;
+        }
+    }
+    for (int code : c.calibrationTriggers) {
+        if (code < 0 || code >= N_TRIGGER_CODES) {
+            error = "calibration trigger " + std::to_string(code) + " out of range";
+            return false;
+        }
+    }
+    for (int code : c.muonOnlyTriggers) {
+        if (code < 0 || code >= N_TRIGGER_CODES) {
+            error = "muon-only trigger " + std::to_string(code) + " out of range";
+            return false;
+        }
+        for (int calibration : c.calibrationTriggers) {
+            if (code == calibration) {
+                error = "trigger " + std::to_string(code) + " is both calibration and muon-only";
+                return false;
+            }
+        }
+    }
+    if (c.fitMin < 0 || c.fitMin >= c.fitMax) {
+        error = "fit range must satisfy 0 <= fit_min < fit_max";
+        return false;
+    }
+    for (double start : c.fitScanStarts) {
+        if (start < 0 || start >= c.fitScanEnd) {
+            error = "fit_scan_starts must satisfy 0 <= start < fit_scan_end";
+            return false;
+        }
+    }
+    if (c.selections.empty()) {
+        error = "no selections";
+        return false;
+    }
+    for (size_t i = 0; i < c.selections.size(); i++) {
+        const SelectionConfig &s = c.selections[i];
+        std::string where = "selection " + s.name + ": ";
+        if (s.name.empty() || s.name.find_first_of(" \t,[]") != std::string::npos) {
+            error = "bad selection name '" + s.name + "'";
+            return false;
+        }
+        if (findConfig(c.selections, s.name) != static_cast<int>(i)) {
+            error = "selection " + s.name + " defined twice";
+            return false;
+        }
+        if (s.michelDtMin < 0 || s.michelDtMin >= s.michelDtMax) {
+            error = where + "dt window must satisfy 0 <= michel_dt_min < michel_dt_max";
+            return false;
+        }
+        if (s.muonDeadTime < 0) {
+            error = where + "muon_dead_time must be >= 0";
+            return false;
+        }
+        if (i == 0 && (c.fitMax > s.michelDtMax || (!c.fitScanStarts.empty() && c.fitScanEnd > s.michelDtMax))) {
+            error = where + "fit_max or fit_scan_end is beyond michel_dt_max";
+            return false;
+        }
+        if (energyVsDtFillCode(s.energyVsDtFill) < 0) {
+            error = where + "energy_vs_dt_fill must be dt, michel or all";
+            return false;
+        }
+        if (s.michelEnergyBins <= 0 || s.dtBins <= 0 || s.energyVsDtMaxDt <= 0 || s.energyVsDtMaxEnergy <= 0) {
+            error = where + "histogram bins and ranges must be positive";
+            return false;
+        }
+        for (int j = 0; j < N_VETO_PANELS; j++) {
+            if (s.panelThreshold[j] < 0) {
+                error = where + "panel_thresholds must not be negative";
+                return false;
+            }
+        }
+        if (!selectionProcessor(s.vetoConvention, s.multiplicity)) {
+            error = where + "unknown veto_convention or multiplicity";
+            return false;
+        }
+        CutFlow cuts;
+        std::string cutError;
+        if (!cuts.compile(s.muonCuts, cutError)) {
+            error = where + "muon_cuts: " + cutError;
+            return false;
+        }
+        if (!cuts.compile(s.michelCuts, cutError)) {
+            error = where + "michel_cuts: " + cutError;
+            return false;
+        }
+        if (!cuts.requiresAtLeast(CUT_VAR_PARENTS, 1)) {
+            error = where + "michel_cuts must require parents >= 1";
+            return false;
+        }
+    }
+    if (static_cast<int>(c.windows.size()) > MAX_DELAYED_WINDOWS) {
+        error = "more than " + std::to_string(MAX_DELAYED_WINDOWS) + " delayed windows";
+        return false;
+    }
+    for (size_t i = 0; i < c.windows.size(); i++) {
+        const DelayedWindowConfig &w = c.windows[i];
+        std::string where = "window " + w.name + ": ";
+        if (w.name.empty() || w.name.find_first_of(" \t,[]") != std::string::npos) {
+            error = "bad window name '" + w.name + "'";
+            return false;
+        }
+        if (findConfig(c.windows, w.name) != static_cast<int>(i)) {
+            error = "window " + w.name + " defined twice";
+            return false;
+        }
+        if (w.dtMin < 0 || w.dtMin >= w.dtMax) {
+            error = where + "must satisfy 0 <= dt_min < dt_max";
+            return false;
+        }
+        if (w.energyBins <= 0 || w.maxEnergy <= 0 || w.dtBins <= 0) {
+            error = where + "histogram bins and ranges must be positive";
+            return false;
+        }
+        CutFlow cuts;
+        std::string cutError;
+        if (!cuts.compile(w.cuts, cutError)) {
+            error = where + "cuts: " + cutError;
+            return false;
+        }
+        if (!cuts.requiresAtLeast(CUT_VAR_PARENTS, 1)) {
+            error = where + "cuts must require parents >= 1";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read "key = value" lines over the defaults. Global keys come first; each
+// "[selection NAME]" line starts a selection and each "[window NAME]" line
+// a delayed window. The first of each kind in the file begins as a copy of
+// the first default one, later ones as a copy of the file's first, so a
+// file lists only what differs from its own first section. If the file
+// defines selections or windows they replace the defaults. '#' starts a
+// comment. The result is validated.
+inline bool readAnalysisConfig(const std::string &path, const AnalysisConfig &defaults,
+                               AnalysisConfig &config, std::string &error) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    config = defaults;
+    bool ownSelections = false;
+    bool ownWindows = false;
+    enum { GLOBAL, SELECTION, WINDOW } section = GLOBAL;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+        if (line[0] == '[') {
+            const std::string selectionPrefix = "[selection ";
+            const std::string windowPrefix = "[window ";
+            if (line[line.size() - 1] == ']' && line.compare(0, selectionPrefix.size(), selectionPrefix) == 0) {
+                SelectionConfig selection = ownSelections ? config.selections[0] : defaults.selections[0];
+                if (!ownSelections) config.selections.clear();
+                ownSelections = true;
+                selection.name = line.substr(selectionPrefix.size(), line.size() - selectionPrefix.size() - 1);
+                config.selections.push_back(selection);
+                section = SELECTION;
+            } else if (line[line.size() - 1] == ']' && line.compare(0, windowPrefix.size(), windowPrefix) == 0) {
+                DelayedWindowConfig window = ownWindows ? config.windows[0]
+                                             : defaults.windows.empty() ? DelayedWindowConfig() : defaults.windows[0];
+                if (!ownWindows) config.windows.clear();
+                ownWindows = true;
+                window.name = line.substr(windowPrefix.size(), line.size() - windowPrefix.size() - 1);
+                config.windows.push_back(window);
+                section = WINDOW;
+            } else {
+                error = where + "expected [selection NAME] or [window NAME]";
+                return false;
+            }
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = where + "expected key = value";
+            return false;
+        }
+        ConfigFieldParser parser;
+        parser.key = line.substr(0, line.find_last_not_of(" \t", equals - 1) + 1);
+        size_t valueStart = line.find_first_not_of(" \t", equals + 1);
+        parser.value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+        parser.matched = false;
+        if (section == SELECTION) {
+            visitSelectionSettings(config.selections.back(), parser);
+        } else if (section == WINDOW) {
+            visitWindowSettings(config.windows.back(), parser);
+        } else {
+            visitGlobalSettings(config, parser);
+        }
+        if (!parser.matched) {
+            const char *kind = section == SELECTION ? "selection" : section == WINDOW ? "window" : "global";
+            error = where + "unknown " + kind + " key '" + parser.key + "'";
+            return false;
+        }
+        if (!parser.error.empty()) {
+            error = where + parser.key + ": " + parser.error;
+            return false;
+        }
+    }
+    if (!validateAnalysisConfig(config, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef CUT_FLOW_H
+#define CUT_FLOW_H
+
+#include "EventKernel.h"
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+// Event quantities a cut can test, filled in by the caller for every event
+const int CUT_VAR_ENERGY = 0;       // Summed PMT energy (p.e.)
+const int CUT_VAR_MUON_ENERGY = 1;  // PMT energy, doubled when PMT pulses run past the window (p.e.)
+const int CUT_VAR_MULTIPLICITY = 2; // Hit PMTs
+const int CUT_VAR_VETO = 3;         // Veto hit mask (see vetoHitMask)
+const int CUT_VAR_VETO_HIT = 4;     // 1 if the veto convention calls it a muon veto
+const int CUT_VAR_VETO_QUIET = 5;   // 1 if the veto convention calls the veto quiet
+const int CUT_VAR_PATH = 6;         // Trigger path (PATH_*)
+const int CUT_VAR_TRIGGER = 7;      // triggerBits, TRIGGER_OTHER (64) for values outside the dispatch table
+const int CUT_VAR_PARENTS = 8;      // Muons in the Michel window
+const int N_CUT_VARS = 9;
+const char *const CUT_VAR_NAMES[N_CUT_VARS] = {"energy", "muon_energy", "multiplicity", "veto", "veto_hit", "veto_quiet",
+                                               "path", "trigger", "parents"};
+
+const int MAX_CUTS = 16; // Cuts per flow; pass bits and a sentinel fit in 32 bits
+
+// One compiled cut. Every comparison is reduced to lo <= x <= hi, with x
+// the variable itself or, for bit tests, whether it shares a bit with the
+// cut's mask. Invert turns the interval test into its complement.
+struct Cut {
+    std::string name;
+    int variable;  // CUT_VAR_*
+    bool bitTest;  // x = (variable & bits) != 0
+    bool invert;
+    double lo;
+    double hi;
+    unsigned bits;
+};
+
+// Ordered list of named cuts, compiled from a text description such as
+//   "energy_min: energy >= 40; veto_quiet: veto !& panels; parent_muon: parents >= 1"
+// Operators are > >= < <= == != and & (shares a bit) !& (shares none).
+// Values are numbers or the names side, top, top_sum, panels, full and
+// muon_only. Veto masks may join the veto names with |, e.g. side | top_sum.
+// Every cut is evaluated for every event without branching on the
+// results; the first failing cut is recorded, which gives the cut-flow
+// table and the pass decision from one count per event.
+class CutFlow {
+public:
+    CutFlow() : nCuts_(0) { resetCounts(); }
+
+    // Replace the cuts with the ones described by spec; false and a message if it does not parse
+    bool compile(const std::string &spec, std::string &error) {
+        nCuts_ = 0;
+        size_t begin = 0;
+        while (begin < spec.size()) {
+            size_t end = spec.find(';', begin);
+            if (end == std::string::npos) end = spec.size();
+            std::string item = trim(spec.substr(begin, end - begin));
+            begin = end + 1;
+            if (item.empty()) continue;
+            if (nCuts_ == MAX_CUTS) {
+                error = "more than " + std::to_string(MAX_CUTS) + " cuts";
+                return false;
+            }
+            if (!compileCut(item, cuts_[nCuts_], error)) return false;
+            nCuts_++;
+        }
+        resetCounts();
+        return true;
+    }
+
+    // Bit i set if cut i passes
+    unsigned passMask(const double *vars) const {
+        unsigned mask = 0;
+        for (int i = 0; i < nCuts_; i++) {
+            const Cut &cut = cuts_[i];
+            double x = vars[cut.variable];
+            double shared = (static_cast<long long>(x) & cut.bits) != 0;
+            x = cut.bitTest ? shared : x;
+            bool inside = (cut.lo <= x) & (x <= cut.hi);
+            mask |= static_cast<unsigned>(inside != cut.invert) << i;
+        }
+        return mask;
+    }
+
+    // Count the event and return true if it passes every cut
+    bool apply(const double *vars) {
+        int firstFailed = __builtin_ctz(~passMask(vars)); // Bit nCuts_ is never set
+        firstFailed_[firstFailed]++;
+        return firstFailed == nCuts_;
+    }
+
+    void resetCounts() {
+        for (int i = 0; i <= MAX_CUTS; i++) firstFailed_[i] = 0;
+    }
+
+    // True if some cut rejects every event with variable < value, for a
+    // variable that is a count (an integer >= 0): parents >= 1, parents > 0
+    // and parents != 0 all require at least one parent
+    bool requiresAtLeast(int variable, double value) const {
+        for (int i = 0; i < nCuts_; i++) {
+            const Cut &cut = cuts_[i];
+            if (cut.variable != variable || cut.bitTest) continue;
+            // Counts 0..value-1 all fall outside lo <= x <= hi, or all inside it if inverted
+            bool rejectsBelow = std::ceil(cut.lo) >= value || cut.hi < 0;
+            if (cut.invert) rejectsBelow = std::ceil(cut.lo) <= 0 && std::floor(cut.hi) >= value - 1;
+            if (rejectsBelow) return true;
+        }
+        return false;
+    }
+
+    int size() const { return nCuts_; }
+    const std::string &name(int i) const { return cuts_[i].name; }
+
+    long events() const {
+        long n = 0;
+        for (int i = 0; i <= nCuts_; i++) n += firstFailed_[i];
+        return n;
+    }
+
+    // Events passing cuts 0..i
+    long passed(int i) const {
+        long n = events();
+        for (int j = 0; j <= i; j++) n -= firstFailed_[j];
+        return n;
+    }
+
+    // Cut-flow table: events left after each cut, as a fraction of the previous line and of the input
+    void print(std::ostream &out, const std::string &title) const {
+        long total = events();
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << title << " cut flow:\n";
+        out << "  " << std::left << std::setw(18) << "input" << std::right << std::setw(12) << total << "\n";
+        long previous = total;
+        for (int i = 0; i < nCuts_; i++) {
+            long n = passed(i);
+            out << "  " << std::left << std::setw(18) << cuts_[i].name << std::right << std::setw(12) << n
+                << std::fixed << std::setprecision(1)
+                << std::setw(8) << (previous > 0 ? 100.0 * n / previous : 0) << "%"
+                << std::setw(8) << (total > 0 ? 100.0 * n / total : 0) << "%\n";
+            previous = n;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    static std::string trim(const std::string &s) {
+        size_t first = s.find_first_not_of(" \t\n");
+        if (first == std::string::npos) return "";
+        return s.substr(first, s.find_last_not_of(" \t\n") - first + 1);
+    }
+
+    // Number or name; for veto masks, several veto names joined with |
+    static bool parseValue(const std::string &text, bool vetoMask, double &value, std::string &error) {
+        static const char *const names[] = {"side", "top", "top_sum", "panels", "full", "muon_only"};
+        static const unsigned values[] = {SIDE_PANEL_BITS, TOP_PANEL_BITS, TOP_SUM_BIT, ALL_PANEL_BITS, PATH_FULL, PATH_MUON_ONLY};
+        const int nVetoNames = 4; // side..panels are veto bits, the rest are path codes
+        bool joined = text.find('|') != std::string::npos;
+        if (joined && !vetoMask) {
+            error = "'|' only joins veto names, in '" + text + "'";
+            return false;
+        }
+        unsigned bits = 0;
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find('|', begin);
+            if (end == std::string::npos) end = text.size();
+            std::string term = trim(text.substr(begin, end - begin));
+            begin = end + 1;
+            int known = -1;
+            for (int i = 0; i < 6; i++) {
+                if (term == names[i]) known = i;
+            }
+            if (joined && (known < 0 || known >= nVetoNames)) {
+                error = "'" + term + "' is not a veto name";
+                return false;
+            }
+            if (known >= 0) {
+                value = values[known];
+            } else {
+                char *parsed = nullptr;
+                value = std::strtod(term.c_str(), &parsed);
+                if (term.empty() || *parsed != '\0') {
+                    error = "bad value '" + term + "'";
+                    return false;
+                }
+            }
+            bits |= static_cast<unsigned>(static_cast<long long>(value));
+        }
+        if (joined) value = bits;
+        return true;
+    }
+
+    static bool compileCut(const std::string &item, Cut &cut, std::string &error) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            error = "cut '" + item + "' has no name";
+            return false;
+        }
+        cut.name = trim(item.substr(0, colon));
+        std::string expr = trim(item.substr(colon + 1));
+
+        // Longest operators first so ">=" is not read as ">"
+        static const char *const ops[] = {">=", "<=", "==", "!=", "!&", ">", "<", "&"};
+        size_t opPos = std::string::npos;
+        std::string op;
+        for (const char *candidate : ops) {
+            size_t pos = expr.find(candidate);
+            if (pos != std::string::npos && pos < opPos) {
+                opPos = pos;
+                op = candidate;
+            }
+        }
+        if (opPos == std::string::npos) {
+            error = "cut '" + cut.name + "' has no operator";
+            return false;
+        }
+        std::string variable = trim(expr.substr(0, opPos));
+        cut.variable = -1;
+        for (int i = 0; i < N_CUT_VARS; i++) {
+            if (variable == CUT_VAR_NAMES[i]) cut.variable = i;
+        }
+        if (cut.variable < 0) {
+            error = "cut '" + cut.name + "' tests unknown variable '" + variable + "'";
+            return false;
+        }
+        double value;
+        if (!parseValue(trim(expr.substr(opPos + op.size())), cut.variable == CUT_VAR_VETO, value, error)) {
+            error = "cut '" + cut.name + "': " + error;
+            return false;
+        }
+
+        cut.bitTest = false;
+        cut.invert = false;
+        cut.lo = -HUGE_VAL;
+        cut.hi = HUGE_VAL;
+        cut.bits = 0;
+        if (op == ">=") {
+            cut.lo = value;
+        } else if (op == ">") {
+            cut.lo = std::nextafter(value, HUGE_VAL);
+        } else if (op == "<=") {
+            cut.hi = value;
+        } else if (op == "<") {
+            cut.hi = std::nextafter(value, -HUGE_VAL);
+        } else if (op == "==" || op == "!=") {
+            cut.lo = value;
+            cut.hi = value;
+            cut.invert = op == "!=";
+        } else {
+            cut.bitTest = true;
+            cut.bits = static_cast<unsigned>(static_cast<long long>(value));
+            cut.lo = 1;
+            cut.hi = 1;
+            cut.invert = op == "!&";
+        }
+        return true;
+    }
+
+    Cut cuts_[MAX_CUTS];
+    int nCuts_;
+    long firstFailed_[MAX_CUTS + 1]; // Events whose first failing cut is i; i = nCuts_ passed all
+};
+
+#endif
@@ -0,0 +1,736 @@
+#ifndef EVENT_KERNEL_H
+#define EVENT_KERNEL_H
+
+#include <algorithm>
+#include <cmath>
+
+// Waveform geometry shared by the reconstruction kernel
+const int ADCSIZE = 45;                 // Number of ADC samples per waveform
+const double SAMPLE_WIDTH_US = 16.0 / 1000.0; // Width of one ADC sample (µs)
+const int OUTLIER_WINDOW_BINS = 10;     // Starts within this many samples of the mode are kept
+const double SINGLE_VARIANCE_MAX = 5 * SAMPLE_WIDTH_US; // Max start variance for a single pulse (µs^2)
+
+const int N_CHANNELS = 23;              // Digitizer channels per event
+const int MAX_PULSES_PER_CHANNEL = (ADCSIZE + 1) / 2; // A closed pulse spans at least two samples
+const int PRE_PULSE_SAMPLES = 15;       // Samples before the veto integration window
+const int EVENT_BATCH_SIZE = 64;        // Events per front-end batch
+const int FIXED_POINT_SHIFT = 8;        // Fixed-point samples are in units of 1/256 ADC
+const double FIXED_POINT_UNIT = 1.0 / (1 << FIXED_POINT_SHIFT); // ADC per fixed-point unit
+
+// Smallest fixed-point value at or above adc, so an integer sample v passes
+// v >= fixedPointCeil(x) exactly when v * FIXED_POINT_UNIT >= x
+inline int fixedPointCeil(double adc) { return static_cast<int>(std::ceil(adc * (1 << FIXED_POINT_SHIFT))); }
+
+// Channel roles
+const unsigned char ROLE_PMT = 0;        // Photomultiplier, gain-calibrated to p.e.
+const unsigned char ROLE_SIDE_PANEL = 1; // Side veto panel (SiPM)
+const unsigned char ROLE_TOP_PANEL = 2;  // Top veto panel (SiPM)
+const unsigned char ROLE_BEAM = 3;       // Beam monitor (EV61)
+
+constexpr double TOP_VP_THRESHOLD = 450; // Default top panel threshold, singly and summed (ADC)
+
+struct ChannelDescriptor {
+    unsigned char role;   // ROLE_*
+    int slot;             // PMT index for gain calibration, panel index for veto energies, -1 otherwise
+    double panelFactor;   // SiPM gain correction for panel energies, 1 otherwise
+    int firstBin;         // Integration window, 1-based and inclusive
+    int lastBin;
+};
+
+// Detector layout, one entry per digitizer channel. Per-role loops,
+// calibration slots and integration windows are all generated from this
+// table, so a layout change is an edit here alone. Panel hit thresholds are
+// analysis cuts and belong to each selection (panel_thresholds).
+// Channels of one role must be contiguous; slots count up from 0 within
+// the PMTs and across side then top panels.
+constexpr ChannelDescriptor CHANNEL_LAYOUT[N_CHANNELS] = {
+    {ROLE_PMT, 0, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 1, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 2, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 3, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 4, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 5, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 6, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 7, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 8, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 9, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 10, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_PMT, 11, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 0, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 1, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 2, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 3, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 4, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 5, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 6, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_SIDE_PANEL, 7, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_TOP_PANEL, 8, 1.07809, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_TOP_PANEL, 9, 1, PRE_PULSE_SAMPLES + 1, ADCSIZE},
+    {ROLE_BEAM, -1, 1, 1, ADCSIZE},
+};
+
+// Channels [first, end) of one role
+struct ChannelRange {
+    int first;
+    int end;
+    constexpr int size() const { return end - first; }
+};
+
+constexpr ChannelRange channelsWithRole(unsigned char role) {
+    ChannelRange range = {0, 0};
+    bool found = false;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        if (CHANNEL_LAYOUT[iChan].role != role) continue;
+        if (!found) range.first = iChan;
+        range.end = iChan + 1;
+        found = true;
+    }
+    return range;
+}
+
+constexpr int countChannels(unsigned char role) {
+    int n = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) n += CHANNEL_LAYOUT[iChan].role == role;
+    return n;
+}
+
+// Bit i set for every channel i of the role
+constexpr unsigned int roleChannelMask(unsigned char role) {
+    unsigned int mask = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        if (CHANNEL_LAYOUT[iChan].role == role) mask |= 1u << iChan;
+    }
+    return mask;
+}
+
+// Slots must run 0, 1, 2... in channel order within the PMTs and within the panels
+constexpr bool slotsAreSequential() {
+    int nextPmt = 0, nextPanel = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        const ChannelDescriptor &d = CHANNEL_LAYOUT[iChan];
+        if (d.role == ROLE_PMT && d.slot != nextPmt++) return false;
+        if ((d.role == ROLE_SIDE_PANEL || d.role == ROLE_TOP_PANEL) && d.slot != nextPanel++) return false;
+    }
+    return true;
+}
+
+constexpr ChannelRange PMT_CHANNELS = channelsWithRole(ROLE_PMT);
+constexpr ChannelRange SIDE_PANEL_CHANNELS = channelsWithRole(ROLE_SIDE_PANEL);
+constexpr ChannelRange TOP_PANEL_CHANNELS = channelsWithRole(ROLE_TOP_PANEL);
+constexpr ChannelRange BEAM_CHANNELS = channelsWithRole(ROLE_BEAM);
+constexpr int N_PMTS = PMT_CHANNELS.size();
+constexpr int N_VETO_PANELS = SIDE_PANEL_CHANNELS.size() + TOP_PANEL_CHANNELS.size();
+constexpr unsigned int PMT_CHANNEL_BITS = roleChannelMask(ROLE_PMT);
+
+static_assert(N_PMTS == countChannels(ROLE_PMT), "PMT channels must be contiguous");
+static_assert(SIDE_PANEL_CHANNELS.size() == countChannels(ROLE_SIDE_PANEL), "Side panels must be contiguous");
+static_assert(TOP_PANEL_CHANNELS.size() == countChannels(ROLE_TOP_PANEL), "Top panels must be contiguous");
+static_assert(BEAM_CHANNELS.size() == countChannels(ROLE_BEAM), "Beam channels must be contiguous");
+static_assert(slotsAreSequential(), "Channel slots must count up from 0 within each role");
+static_assert(N_PMTS <= 16 && N_VETO_PANELS <= 15, "Hit masks are 16 bits wide");
+
+// Pulse found in one channel, before gain calibration
+struct FoundPulse {
+    int startBin;  // Leading-edge sample (1-based)
+    int endBin;    // Last sample of the pulse (1-based)
+    int peakBin;   // Sample with the max amplitude (1-based)
+    double peak;   // Max amplitude (ADC)
+    double energy; // Integrated charge (ADC)
+};
+
+// Temporary pulse structure
+struct pulse_temp {
+    double start;  // Start time (µs)
+    double end;    // End time (µs)
+    double peak;   // Max amplitude
+    double energy; // Energy
+};
+
+// Consensus timing of the PMT pulses in one event
+struct TimingSummary {
+    double start;    // Most frequent start time, or mean if no value repeats (µs)
+    double end;      // Most frequent end time, or mean if no value repeats (µs)
+    double variance; // Variance of the starts within the outlier window (µs^2)
+    bool single;     // Timing consistency
+};
+
+// Mode and spread estimator for quantized pulse times.
+// Pulse start/end times are always whole ADC samples in [1, ADCSIZE], so a
+// counting array replaces the std::map used by mostFrequent() and the
+// outlier-filtered variance comes out of the same counts without a copy.
+class StartTimeEstimator {
+public:
+    StartTimeEstimator() { reset(); }
+
+    void reset() {
+        for (int i = 0; i <= ADCSIZE; i++) {
+            startCount[i] = 0;
+            endCount[i] = 0;
+        }
+        nPulses = 0;
+        startSum = 0;
+        endSum = 0;
+    }
+
+    // Record one pulse by its start and end sample (1-based)
+    void add(int startBin, int endBin) {
+        startCount[startBin]++;
+        endCount[endBin]++;
+        startSum += startBin;
+        endSum += endBin;
+        nPulses++;
+    }
+
+    int size() const { return nPulses; }
+
+    TimingSummary summarize() const {
+        TimingSummary s;
+        double startBin = modeBin(startCount, startSum);
+        s.start = startBin * SAMPLE_WIDTH_US;
+        s.end = modeBin(endCount, endSum) * SAMPLE_WIDTH_US;
+
+        // Outlier-filtered variance from the start counts
+        long n = 0;
+        double sum = 0, sumSq = 0;
+        for (int bin = 1; bin <= ADCSIZE; bin++) {
+            if (startCount[bin] == 0 || std::fabs(bin - startBin) >= OUTLIER_WINDOW_BINS) continue;
+            n += startCount[bin];
+            sum += static_cast<double>(startCount[bin]) * bin;
+            sumSq += static_cast<double>(startCount[bin]) * bin * bin;
+        }
+        s.variance = 0;
+        if (n > 1) {
+            s.variance = (sumSq - sum * sum / n) / (n - 1) * SAMPLE_WIDTH_US * SAMPLE_WIDTH_US;
+        }
+        s.single = s.variance < SINGLE_VARIANCE_MAX;
+        return s;
+    }
+
+private:
+    // Smallest most frequent bin; mean bin if no bin repeats (same rule as mostFrequent)
+    double modeBin(const int *count, long sum) const {
+        if (nPulses == 0) return 0;
+        int mostCommon = 0;
+        int maxCount = 0;
+        for (int bin = 1; bin <= ADCSIZE; bin++) {
+            if (count[bin] > maxCount) {
+                maxCount = count[bin];
+                mostCommon = bin;
+            }
+        }
+        return maxCount > 1 ? mostCommon : static_cast<double>(sum) / nPulses;
+    }
+
+    int startCount[ADCSIZE + 1]; // Pulses per start sample
+    int endCount[ADCSIZE + 1];   // Pulses per end sample
+    int nPulses;                 // Number of pulses recorded
+    long startSum;               // Sum of start samples
+    long endSum;                 // Sum of end samples
+};
+
+// Number of PMTs in a hit mask; each PMT counts once however many pulses it had
+inline int pmtMultiplicity(unsigned int pmtHitMask) {
+    return __builtin_popcount(pmtHitMask);
+}
+
+// Veto hit mask layout: bit i is the panel in slot i over its own threshold,
+// bit N_VETO_PANELS is the summed top-panel energy over the top threshold
+const unsigned short SIDE_PANEL_BITS = (1u << SIDE_PANEL_CHANNELS.size()) - 1;
+const unsigned short TOP_PANEL_BITS = ((1u << TOP_PANEL_CHANNELS.size()) - 1) << SIDE_PANEL_CHANNELS.size();
+const unsigned short TOP_SUM_BIT = 1 << N_VETO_PANELS;
+const unsigned short ALL_PANEL_BITS = SIDE_PANEL_BITS | TOP_PANEL_BITS;
+
+// Compare all panel energies against their thresholds, given by panel slot, in one branch-free pass
+inline unsigned short vetoHitMask(const double *vetoEnergy, const double *panelThreshold, double topEnergy, double topSumThreshold) {
+    unsigned mask = 0;
+    for (int i = 0; i < N_VETO_PANELS; i++) {
+        mask |= static_cast<unsigned>(vetoEnergy[i] > panelThreshold[i]) << i;
+    }
+    mask |= static_cast<unsigned>(topEnergy > topSumThreshold) << N_VETO_PANELS;
+    return static_cast<unsigned short>(mask);
+}
+
+// Per-channel gain calibration, built once after performCalibration().
+// Folding the mu1 > 0 check into scale factors lets the kernel calibrate
+// every pulse with a single multiply.
+struct CalibrationTable {
+    double peakScale[N_CHANNELS];   // 1/mu1 for calibrated PMTs, 1 otherwise
+    double energyScale[N_CHANNELS]; // 1/mu1 for calibrated PMTs, 0 for uncalibrated PMTs, 1 otherwise
+    unsigned int validMask;         // Bit i set if PMT i has a usable gain
+};
+
+inline CalibrationTable buildCalibrationTable(const double *mu1) {
+    CalibrationTable cal;
+    cal.validMask = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        cal.peakScale[iChan] = 1.0;
+        cal.energyScale[iChan] = 1.0;
+    }
+    for (int iChan = PMT_CHANNELS.first; iChan < PMT_CHANNELS.end; iChan++) {
+        int pmt = CHANNEL_LAYOUT[iChan].slot;
+        if (mu1[pmt] > 0) {
+            cal.peakScale[iChan] = 1.0 / mu1[pmt];
+            cal.energyScale[iChan] = 1.0 / mu1[pmt];
+            cal.validMask |= 1u << pmt;
+        } else {
+            cal.energyScale[iChan] = 0;
+        }
+    }
+    return cal;
+}
+
+// Reconstruction paths an event can be dispatched to by its trigger
+const unsigned char PATH_CALIBRATION = 0; // PMT charge accumulated for gain monitoring, no pulse finding
+const unsigned char PATH_MUON_ONLY = 1;   // PMT pulses and veto sums for muon tagging, no Michel search
+const unsigned char PATH_FULL = 2;        // Full reconstruction and selection
+const int N_EVENT_PATHS = 3;
+const int N_TRIGGER_CODES = 64;           // triggerBits values covered by the table
+const unsigned char TRIGGER_OTHER = N_TRIGGER_CODES; // Stored trigger for values outside the table
+
+// triggerBits as kept in the event record; values outside the table,
+// negative or past a byte, all become TRIGGER_OTHER instead of wrapping
+inline unsigned char storedTrigger(int triggerBits) {
+    return triggerBits >= 0 && triggerBits < N_TRIGGER_CODES ? static_cast<unsigned char>(triggerBits) : TRIGGER_OTHER;
+}
+
+// Path for every trigger value, looked up once per event before any
+// channel is touched. Values outside the table take the full path.
+struct TriggerDispatch {
+    unsigned char path[N_TRIGGER_CODES];
+
+    unsigned char route(int trigger) const {
+        return trigger >= 0 && trigger < N_TRIGGER_CODES ? path[trigger] : PATH_FULL;
+    }
+};
+
+inline TriggerDispatch buildTriggerDispatch(const int *calibrationTriggers, int nCalibration,
+                                            const int *muonOnlyTriggers, int nMuonOnly) {
+    TriggerDispatch dispatch;
+    for (int i = 0; i < N_TRIGGER_CODES; i++) dispatch.path[i] = PATH_FULL;
+    for (int i = 0; i < nMuonOnly; i++) dispatch.path[muonOnlyTriggers[i]] = PATH_MUON_ONLY;
+    for (int i = 0; i < nCalibration; i++) dispatch.path[calibrationTriggers[i]] = PATH_CALIBRATION;
+    return dispatch;
+}
+
+// Thresholds applied by the front end
+struct FrontEndSettings {
+    double pulseThreshold[N_CHANNELS]; // A channel is searched for pulses if any sample reaches this (ADC)
+    double flatThreshold[N_CHANNELS];  // pulseThreshold before applyNoiseThresholds, counted for comparison (ADC)
+    double baselineUncertainty;        // Samples above this form the leading-edge mask (ADC)
+    double lateThreshold;              // Last sample above this means a pulse runs past the window (ADC)
+    int saturationLevel;               // Raw ADC code at digitizer full scale
+};
+
+// Same pulse threshold on every channel
+inline FrontEndSettings makeFrontEndSettings(double pulseThreshold, double baselineUncertainty,
+                                             double lateThreshold, int saturationLevel) {
+    FrontEndSettings settings;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        settings.pulseThreshold[iChan] = pulseThreshold;
+        settings.flatThreshold[iChan] = pulseThreshold;
+    }
+    settings.baselineUncertainty = baselineUncertainty;
+    settings.lateThreshold = lateThreshold;
+    settings.saturationLevel = saturationLevel;
+    return settings;
+}
+
+// Raise each channel's pulse threshold to nSigma times its noise RMS.
+// The existing threshold is the floor, so quiet channels are unchanged.
+// Returns a mask of the channels that were raised (bit i for channel i).
+inline unsigned int applyNoiseThresholds(FrontEndSettings &settings, const double *rms, double nSigma) {
+    unsigned int raised = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        double noiseThreshold = nSigma * rms[iChan];
+        if (noiseThreshold > settings.pulseThreshold[iChan]) {
+            settings.pulseThreshold[iChan] = noiseThreshold;
+            raised |= 1u << iChan;
+        }
+    }
+    return raised;
+}
+
+// Per-channel front-end flags
+const unsigned char FLAG_LATE_PULSE = 1 << 0; // Last sample over the late-pulse threshold
+const unsigned char FLAG_SATURATED = 1 << 1;  // Some raw sample at full scale
+const unsigned char FLAG_CLIPPED = 1 << 2;    // Two consecutive samples at full scale (flat-topped pulse)
+
+// Channel-major batch of raw events, indexed [channel][sample][event].
+// The same sample of the same channel from consecutive events is contiguous,
+// so the front end runs across events in SIMD lanes. A single event is
+// simply EventBatch<1>; both paths go through runFrontEnd().
+template <int N>
+struct EventBatch {
+    short raw[N_CHANNELS][ADCSIZE][N];     // Raw ADC samples
+    double baseline[N_CHANNELS][N];        // Stored baseline means (ADC)
+    double wf[N_CHANNELS][ADCSIZE][N];     // Baseline-subtracted samples, filled by runFrontEnd (ADC)
+    int fixedWf[N_CHANNELS][ADCSIZE][N];   // Same, filled by runFrontEndFixed instead (1/256 ADC)
+    long long nsTime[N];                   // Event time (ns)
+    int triggerBits[N];                    // Trigger type
+    int eventID[N];                        // Event number in the run
+    int nEvents;                           // Lanes in use
+
+    void clear() { nEvents = 0; }
+    bool full() const { return nEvents == N; }
+
+    // Transpose one event into the next free lane
+    void add(const short adcVal[][ADCSIZE], const double *baselineMean, long long time, int trigger, int id) {
+        int lane = nEvents++;
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            for (int i = 0; i < ADCSIZE; i++) raw[iChan][i][lane] = adcVal[iChan][i];
+            baseline[iChan][lane] = baselineMean[iChan];
+        }
+        nsTime[lane] = time;
+        triggerBits[lane] = trigger;
+        eventID[lane] = id;
+    }
+};
+
+// Front-end output as structure of arrays, indexed [channel](sample)[event].
+// Every window integral is a difference of two prefix sums, taken from the
+// double or the fixed-point array depending on which front end filled it.
+template <int N>
+struct FrontEndBatch {
+    double cumulative[N_CHANNELS][ADCSIZE + 1][N];    // Prefix sums: cumulative[c][i] = samples 1..i (ADC)
+    int fixedCumulative[N_CHANNELS][ADCSIZE + 1][N];  // Same prefix sums in fixed point (1/256 ADC)
+    unsigned long long aboveNoise[N_CHANNELS][N];     // Bit i set if sample i (1-based) exceeds the baseline uncertainty
+    unsigned char overThreshold[N_CHANNELS][N];       // Any sample at or above the pulse threshold
+    unsigned char pulseCount[N_CHANNELS][N];          // Pulses the threshold finder opens at the pulse threshold
+    unsigned char flatPulseCount[N_CHANNELS][N];      // Same at the flat threshold, for the noise-threshold comparison
+    double threshold[N_CHANNELS];                     // Pulse threshold applied to each channel (ADC)
+    unsigned char flags[N_CHANNELS][N];               // FLAG_* bits per channel
+    bool fixedPoint;                                  // Filled by runFrontEndFixed()
+
+    // Channels of one event with the given flag set, bit i for channel i
+    unsigned int channelMask(int lane, unsigned char flag) const {
+        unsigned int mask = 0;
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            mask |= static_cast<unsigned int>((flags[iChan][lane] & flag) != 0) << iChan;
+        }
+        return mask;
+    }
+
+    // Prefix sum of samples 1..iBin (ADC)
+    double prefix(int iChan, int iBin, int lane) const {
+        return fixedPoint ? fixedCumulative[iChan][iBin][lane] * FIXED_POINT_UNIT : cumulative[iChan][iBin][lane];
+    }
+
+    // Sum of samples firstBin..lastBin (1-based, inclusive)
+    double integral(int iChan, int lane, int firstBin, int lastBin) const {
+        if (fixedPoint) {
+            return (fixedCumulative[iChan][lastBin][lane] - fixedCumulative[iChan][firstBin - 1][lane]) * FIXED_POINT_UNIT;
+        }
+        return cumulative[iChan][lastBin][lane] - cumulative[iChan][firstBin - 1][lane];
+    }
+};
+
+// Fixed-capacity working set for reconstructing one event.
+// Sized for the worst case (every channel full of two-sample pulses), so
+// reset() only clears counters and no event ever touches the heap.
+struct EventWorkspace {
+    double wf[ADCSIZE + 1];                                 // Baseline-subtracted waveform, 1-based like TH1 bins
+    int fixedWf[ADCSIZE + 1];                               // Same in fixed point, loaded instead of wf (1/256 ADC)
+    bool fixedPoint;                                        // The channel was loaded from the fixed-point front end
+    double cumulative[ADCSIZE + 1];                         // cumulative[i] = wf[1] + ... + wf[i]
+    unsigned long long aboveNoise;                          // Bit i set if wf[i] > baseline uncertainty
+    double threshold;                                       // Pulse threshold of the loaded channel (ADC)
+    int fixedThreshold;                                     // Same, as fixedPointCeil(threshold)
+    FoundPulse found[MAX_PULSES_PER_CHANNEL];               // Pulse finder output for the current channel
+    pulse_temp pulses[N_CHANNELS][MAX_PULSES_PER_CHANNEL];  // Pulses found per channel
+    int nPulses[N_CHANNELS];                                // Number of pulses per channel
+    double vetoEnergy[N_VETO_PANELS];                       // Veto panel energies by panel slot (ADC)
+    StartTimeEstimator timing;                              // PMT pulse start/end times
+    double pmtEnergy;                                       // Sum of PMT pulse energies (p.e.)
+    double pmtPeak;                                         // Sum of PMT pulse peaks (p.e.)
+    unsigned short pmtHitMask;                              // Bit i set if PMT i has a pulse over its hit threshold
+    double sideVetoEnergy;                                  // Sum of side panel energies (ADC)
+    double topVetoEnergy;                                   // Sum of top panel energies (ADC)
+
+    void reset() {
+        for (int i = 0; i < N_CHANNELS; i++) nPulses[i] = 0;
+        for (int i = 0; i < N_VETO_PANELS; i++) vetoEnergy[i] = 0;
+        timing.reset();
+        pmtEnergy = 0;
+        pmtPeak = 0;
+        pmtHitMask = 0;
+        sideVetoEnergy = 0;
+        topVetoEnergy = 0;
+    }
+
+    void addPulse(int iChan, const pulse_temp &pt) {
+        if (nPulses[iChan] < MAX_PULSES_PER_CHANNEL) pulses[iChan][nPulses[iChan]++] = pt;
+    }
+
+    // Sum of wf[firstBin..lastBin] (1-based, inclusive; empty if lastBin < firstBin)
+    double integral(int firstBin, int lastBin) const {
+        return lastBin < firstBin ? 0.0 : cumulative[lastBin] - cumulative[firstBin - 1];
+    }
+
+    // First bin of the run of above-noise samples that ends just before peakBin.
+    // Returns peakBin when the sample before the peak is already within the noise.
+    int leadingEdgeBin(int peakBin) const {
+        unsigned long long belowPeak = (1ULL << peakBin) - 1;
+        unsigned long long quiet = (~aboveNoise & belowPeak) | 1ULL; // Bin 0 stops the search
+        return 64 - __builtin_clzll(quiet);
+    }
+
+    // Copy one channel of one lane from the front end. After the fixed-point
+    // front end only fixedWf is filled, so the finders test integer samples.
+    template <int N>
+    void loadChannel(const EventBatch<N> &batch, const FrontEndBatch<N> &fe, int iChan, int lane) {
+        fixedPoint = fe.fixedPoint;
+        cumulative[0] = 0;
+        if (fixedPoint) {
+            fixedWf[0] = 0;
+            for (int i = 0; i < ADCSIZE; i++) fixedWf[i + 1] = batch.fixedWf[iChan][i][lane];
+        } else {
+            for (int i = 0; i < ADCSIZE; i++) wf[i + 1] = batch.wf[iChan][i][lane];
+        }
+        for (int i = 0; i < ADCSIZE; i++) cumulative[i + 1] = fe.prefix(iChan, i + 1, lane);
+        aboveNoise = fe.aboveNoise[iChan][lane];
+        threshold = fe.threshold[iChan];
+        fixedThreshold = fixedPointCeil(threshold);
+    }
+};
+
+// Workspace owned by the calling thread, reused for every event it processes
+inline EventWorkspace &eventWorkspace() {
+    static thread_local EventWorkspace ws;
+    return ws;
+}
+
+// Batch and front-end output owned by the calling thread
+inline EventBatch<EVENT_BATCH_SIZE> &eventBatch() {
+    static thread_local EventBatch<EVENT_BATCH_SIZE> batch;
+    return batch;
+}
+
+inline FrontEndBatch<EVENT_BATCH_SIZE> &frontEndBatch() {
+    static thread_local FrontEndBatch<EVENT_BATCH_SIZE> out;
+    return out;
+}
+
+// Second output buffer, used to validate one front end against the other
+inline FrontEndBatch<EVENT_BATCH_SIZE> &referenceFrontEndBatch() {
+    static thread_local FrontEndBatch<EVENT_BATCH_SIZE> out;
+    return out;
+}
+
+// Running per-channel baseline estimated from the pre-pulse samples
+// (bins 1..PRE_PULSE_SAMPLES). Events whose pre-pulse window is quiet update
+// an exponential average; once a channel has seen BASELINE_TRACKER_WARMUP
+// quiet events, a stored baselineMean that differs from it by more than the
+// tolerance is replaced and counted. Until then the stored value is kept.
+const int BASELINE_TRACKER_WEIGHT = 16; // Averaging length of the running estimate (events)
+const int BASELINE_TRACKER_WARMUP = 8;  // Quiet events before the estimate is trusted
+
+class BaselineTracker {
+public:
+    BaselineTracker(double tolerance, double quietSpread)
+        : tolerance_(tolerance), quietSpread_(quietSpread) { reset(); }
+
+    // Start a new run
+    void reset() {
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            estimate_[iChan] = 0;
+            nQuiet_[iChan] = 0;
+            disagreements_[iChan] = 0;
+        }
+        nEvents_ = 0;
+    }
+
+    // Update the running estimates from a batch, in event order, and
+    // overwrite batch.baseline wherever the stored value disagrees
+    template <int N>
+    void apply(EventBatch<N> &batch) {
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            int sum[N], lo[N], hi[N];
+            for (int lane = 0; lane < N; lane++) {
+                sum[lane] = 0;
+                lo[lane] = hi[lane] = batch.raw[iChan][0][lane];
+            }
+            for (int i = 0; i < PRE_PULSE_SAMPLES; i++) {
+                const short *raw = batch.raw[iChan][i];
+                for (int lane = 0; lane < N; lane++) {
+                    sum[lane] += raw[lane];
+                    lo[lane] = std::min(lo[lane], static_cast<int>(raw[lane]));
+                    hi[lane] = std::max(hi[lane], static_cast<int>(raw[lane]));
+                }
+            }
+            for (int lane = 0; lane < batch.nEvents; lane++) {
+                if (hi[lane] - lo[lane] <= quietSpread_) {
+                    double mean = static_cast<double>(sum[lane]) / PRE_PULSE_SAMPLES;
+                    int n = std::min(++nQuiet_[iChan], BASELINE_TRACKER_WEIGHT);
+                    estimate_[iChan] += (mean - estimate_[iChan]) / n;
+                }
+                if (nQuiet_[iChan] >= BASELINE_TRACKER_WARMUP &&
+                    std::fabs(batch.baseline[iChan][lane] - estimate_[iChan]) > tolerance_) {
+                    batch.baseline[iChan][lane] = estimate_[iChan];
+                    disagreements_[iChan]++;
+                }
+            }
+        }
+        nEvents_ += batch.nEvents;
+    }
+
+    long disagreements(int iChan) const { return disagreements_[iChan]; }
+    long events() const { return nEvents_; }
+    double estimate(int iChan) const { return estimate_[iChan]; }
+
+private:
+    double tolerance_;              // Allowed |stored - running| before overriding (ADC)
+    double quietSpread_;            // Max pre-pulse max-min for an event to update the estimate (ADC)
+    double estimate_[N_CHANNELS];   // Running baseline (ADC)
+    int nQuiet_[N_CHANNELS];        // Quiet events seen this run
+    long disagreements_[N_CHANNELS]; // Events whose stored baseline was overridden
+    long nEvents_;                  // Events seen this run
+};
+
+// Baseline subtraction, prefix sums, noise mask, threshold detection, pulse
+// counts and channel flags for a batch, all in one sweep over the samples. The inner
+// loops run over all N lanes (unused lanes hold stale data) so they
+// vectorize without a remainder loop.
+template <int N>
+void runFrontEnd(EventBatch<N> &batch, const FrontEndSettings &settings, FrontEndBatch<N> &out) {
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        unsigned long long *noise = out.aboveNoise[iChan];
+        unsigned char *over = out.overThreshold[iChan];
+        unsigned char *count = out.pulseCount[iChan];
+        unsigned char *flatCount = out.flatPulseCount[iChan];
+        unsigned char *flags = out.flags[iChan];
+        const double *base = batch.baseline[iChan];
+        const double threshold = settings.pulseThreshold[iChan];
+        const double flatThreshold = settings.flatThreshold[iChan];
+        out.threshold[iChan] = threshold;
+        unsigned char prevSaturated[N];
+        unsigned char onPulse[N], onFlatPulse[N];
+        for (int lane = 0; lane < N; lane++) {
+            out.cumulative[iChan][0][lane] = 0;
+            noise[lane] = 0;
+            over[lane] = 0;
+            count[lane] = 0;
+            flatCount[lane] = 0;
+            flags[lane] = 0;
+            prevSaturated[lane] = 0;
+            onPulse[lane] = 0;
+            onFlatPulse[lane] = 0;
+        }
+        for (int i = 0; i < ADCSIZE; i++) {
+            const short *raw = batch.raw[iChan][i];
+            double *wf = batch.wf[iChan][i];
+            const unsigned char notLast = i < ADCSIZE - 1;
+            const double *prev = out.cumulative[iChan][i];
+            double *cum = out.cumulative[iChan][i + 1];
+            for (int lane = 0; lane < N; lane++) {
+                double v = raw[lane] - base[lane];
+                unsigned char saturated = raw[lane] >= settings.saturationLevel;
+                unsigned char quiet = v < settings.baselineUncertainty;
+                wf[lane] = v;
+                cum[lane] = prev[lane] + v;
+                noise[lane] |= static_cast<unsigned long long>(v > settings.baselineUncertainty) << (i + 1);
+                over[lane] |= v >= threshold;
+                // Open at the threshold, close below the baseline uncertainty, as ThresholdPulseFinder;
+                // like it, a pulse opening on the last sample is not counted
+                unsigned char opens = (v >= threshold) & !onPulse[lane] & notLast;
+                unsigned char flatOpens = (v >= flatThreshold) & !onFlatPulse[lane] & notLast;
+                count[lane] += opens;
+                flatCount[lane] += flatOpens;
+                onPulse[lane] = opens | (onPulse[lane] & !quiet);
+                onFlatPulse[lane] = flatOpens | (onFlatPulse[lane] & !quiet);
+                flags[lane] |= (saturated * FLAG_SATURATED) | ((saturated & prevSaturated[lane]) * FLAG_CLIPPED);
+                prevSaturated[lane] = saturated;
+            }
+        }
+        const double *last = batch.wf[iChan][ADCSIZE - 1];
+        for (int lane = 0; lane < N; lane++) {
+            flags[lane] |= (last[lane] > settings.lateThreshold) * FLAG_LATE_PULSE;
+        }
+    }
+    out.fixedPoint = false;
+}
+
+// Integer variant of runFrontEnd(). Baselines are rounded once to 1/256 ADC,
+// samples are shifted into the same scale and all accumulation runs in int32
+// lanes (twice as many per vector as double). The samples stay int32 in
+// batch.fixedWf for the pulse finders' threshold and peak tests; doubles only
+// reappear when an integral or peak is read out for gain calibration. Even 45 saturated samples stay
+// far below 2^31, so the prefix sums cannot overflow.
+template <int N>
+void runFrontEndFixed(EventBatch<N> &batch, const FrontEndSettings &settings, FrontEndBatch<N> &out) {
+    const int noiseFixed = static_cast<int>(std::floor(settings.baselineUncertainty * (1 << FIXED_POINT_SHIFT)));
+    const int lateFixed = static_cast<int>(std::floor(settings.lateThreshold * (1 << FIXED_POINT_SHIFT)));
+    const int closeFixed = fixedPointCeil(settings.baselineUncertainty);
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        unsigned long long *noise = out.aboveNoise[iChan];
+        unsigned char *over = out.overThreshold[iChan];
+        unsigned char *count = out.pulseCount[iChan];
+        unsigned char *flatCount = out.flatPulseCount[iChan];
+        unsigned char *flags = out.flags[iChan];
+        const int thresholdFixed = fixedPointCeil(settings.pulseThreshold[iChan]);
+        const int flatFixed = fixedPointCeil(settings.flatThreshold[iChan]);
+        out.threshold[iChan] = settings.pulseThreshold[iChan];
+        int base[N];
+        unsigned char prevSaturated[N];
+        unsigned char onPulse[N], onFlatPulse[N];
+        for (int lane = 0; lane < N; lane++) {
+            base[lane] = static_cast<int>(std::lround(batch.baseline[iChan][lane] * (1 << FIXED_POINT_SHIFT)));
+            out.fixedCumulative[iChan][0][lane] = 0;
+            noise[lane] = 0;
+            over[lane] = 0;
+            count[lane] = 0;
+            flatCount[lane] = 0;
+            flags[lane] = 0;
+            prevSaturated[lane] = 0;
+            onPulse[lane] = 0;
+            onFlatPulse[lane] = 0;
+        }
+        for (int i = 0; i < ADCSIZE; i++) {
+            const short *raw = batch.raw[iChan][i];
+            int *wf = batch.fixedWf[iChan][i];
+            const unsigned char notLast = i < ADCSIZE - 1;
+            const int *prev = out.fixedCumulative[iChan][i];
+            int *cum = out.fixedCumulative[iChan][i + 1];
+            for (int lane = 0; lane < N; lane++) {
+                int v = (static_cast<int>(raw[lane]) << FIXED_POINT_SHIFT) - base[lane];
+                unsigned char saturated = raw[lane] >= settings.saturationLevel;
+                unsigned char quiet = v < closeFixed;
+                wf[lane] = v;
+                cum[lane] = prev[lane] + v;
+                noise[lane] |= static_cast<unsigned long long>(v > noiseFixed) << (i + 1);
+                over[lane] |= v >= thresholdFixed;
+                unsigned char opens = (v >= thresholdFixed) & !onPulse[lane] & notLast;
+                unsigned char flatOpens = (v >= flatFixed) & !onFlatPulse[lane] & notLast;
+                count[lane] += opens;
+                flatCount[lane] += flatOpens;
+                onPulse[lane] = opens | (onPulse[lane] & !quiet);
+                onFlatPulse[lane] = flatOpens | (onFlatPulse[lane] & !quiet);
+                flags[lane] |= (saturated * FLAG_SATURATED) | ((saturated & prevSaturated[lane]) * FLAG_CLIPPED);
+                prevSaturated[lane] = saturated;
+            }
+        }
+        const int *lastCum = out.fixedCumulative[iChan][ADCSIZE];
+        const int *prevCum = out.fixedCumulative[iChan][ADCSIZE - 1];
+        for (int lane = 0; lane < N; lane++) {
+            flags[lane] |= (lastCum[lane] - prevCum[lane] > lateFixed) * FLAG_LATE_PULSE;
+        }
+    }
+    out.fixedPoint = true;
+}
+
+// Largest difference between the fixed-point and double prefix sums of the
+// first nEvents lanes (ADC). Any window integral deviates by at most twice this.
+template <int N>
+double maxFixedPointDeviation(const FrontEndBatch<N> &fixed, const FrontEndBatch<N> &reference, int nEvents) {
+    double maxDeviation = 0;
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        for (int i = 1; i <= ADCSIZE; i++) {
+            for (int lane = 0; lane < nEvents; lane++) {
+                double d = std::fabs(fixed.prefix(iChan, i, lane) - reference.prefix(iChan, i, lane));
+                if (d > maxDeviation) maxDeviation = d;
+            }
+        }
+    }
+    return maxDeviation;
+}
+
+#endif
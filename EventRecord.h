@@ -0,0 +1,109 @@
+#ifndef EVENT_RECORD_H
+#define EVENT_RECORD_H
+
+#include "EventKernel.h"
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Event status bits kept in HotEvent::flags
+const unsigned char EVENT_SINGLE = 1 << 0; // PMT start times consistent
+const unsigned char EVENT_BEAM = 1 << 1;   // Beam channel over EV61 threshold
+const unsigned char EVENT_MUON = 1 << 2;   // Muon candidate
+const unsigned char EVENT_MICHEL = 1 << 3; // Michel electron candidate
+
+// Fields read by the selection for every event, 32 bytes. Time is kept in
+// integer ns so differences stay exact however long the run; energies are
+// float, which is far finer than the p.e. calibration.
+struct HotEvent {
+    long long startNs;       // Event time plus PMT start time (ns)
+    float energy;            // Summed PMT energy (p.e.)
+    float sideVetoEnergy;    // Summed side panel energy (ADC)
+    float topVetoEnergy;     // Summed top panel energy (ADC)
+    unsigned short pmtMask;  // Bit i set if PMT i is hit
+    unsigned short vetoMask; // Veto panels over threshold (see vetoHitMask)
+    unsigned char trigger;   // triggerBits, TRIGGER_OTHER outside the dispatch table
+    unsigned char flags;     // EVENT_* bits
+
+    int multiplicity() const { return pmtMultiplicity(pmtMask); }
+    double startUs() const { return startNs / 1000.0; }
+};
+static_assert(sizeof(HotEvent) <= 32, "HotEvent must stay within half a cache line");
+
+// Attributes only needed for plots and debugging
+struct ColdEvent {
+    double end;                 // End time (µs)
+    double peak;                // Summed PMT peak (p.e.)
+    unsigned int lateMask;      // Channels whose last sample is over the late-pulse threshold
+    unsigned int saturatedMask; // Channels with a sample at ADC full scale
+    unsigned int clippedMask;   // Channels with a flat-topped (clipped) pulse
+    int eventID;                // Event number in the run
+};
+
+// Start time in ns from the event time and the PMT consensus start (µs)
+inline long long eventStartNs(long long nsTime, double startUs) {
+    return nsTime + std::llround(startUs * 1000.0);
+}
+
+// Buffered events of one run as structure of arrays: a scan over one hot
+// field touches only that field, and the cold side table is indexed by the
+// same position. Capacity is kept across clear(), so a reused store stops
+// allocating once it has seen its largest run.
+class EventStore {
+public:
+    void clear() {
+        startNs.clear();
+        energy.clear();
+        sideVetoEnergy.clear();
+        topVetoEnergy.clear();
+        pmtMask.clear();
+        vetoMask.clear();
+        trigger.clear();
+        flags.clear();
+        cold.clear();
+    }
+
+    std::size_t size() const { return startNs.size(); }
+
+    // Append an event and return its index
+    std::size_t add(const HotEvent &hot, const ColdEvent &coldEvent) {
+        startNs.push_back(hot.startNs);
+        energy.push_back(hot.energy);
+        sideVetoEnergy.push_back(hot.sideVetoEnergy);
+        topVetoEnergy.push_back(hot.topVetoEnergy);
+        pmtMask.push_back(hot.pmtMask);
+        vetoMask.push_back(hot.vetoMask);
+        trigger.push_back(hot.trigger);
+        flags.push_back(hot.flags);
+        cold.push_back(coldEvent);
+        return startNs.size() - 1;
+    }
+
+    HotEvent hot(std::size_t i) const {
+        HotEvent h;
+        h.startNs = startNs[i];
+        h.energy = energy[i];
+        h.sideVetoEnergy = sideVetoEnergy[i];
+        h.topVetoEnergy = topVetoEnergy[i];
+        h.pmtMask = pmtMask[i];
+        h.vetoMask = vetoMask[i];
+        h.trigger = trigger[i];
+        h.flags = flags[i];
+        return h;
+    }
+
+    // Hot fields, one array each
+    std::vector<long long> startNs;
+    std::vector<float> energy;
+    std::vector<float> sideVetoEnergy;
+    std::vector<float> topVetoEnergy;
+    std::vector<unsigned short> pmtMask;
+    std::vector<unsigned short> vetoMask;
+    std::vector<unsigned char> trigger;
+    std::vector<unsigned char> flags;
+
+    // Cold side table
+    std::vector<ColdEvent> cold;
+};
+
+#endif
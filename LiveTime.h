@@ -0,0 +1,106 @@
+#ifndef LIVE_TIME_H
+#define LIVE_TIME_H
+
+#include <climits>
+
+// Exposure of one run or job, split by beam state (0 off, 1 on)
+struct LiveTimeCounts {
+    long long spanNs[2]; // Time between the first and last event
+    long long deadNs[2]; // Part of spanNs inside a muon veto window
+    long muons;          // Muons that opened or extended a veto window
+
+    void reset() {
+        spanNs[0] = spanNs[1] = 0;
+        deadNs[0] = deadNs[1] = 0;
+        muons = 0;
+    }
+
+    void add(const LiveTimeCounts &other) {
+        for (int beam = 0; beam < 2; beam++) {
+            spanNs[beam] += other.spanNs[beam];
+            deadNs[beam] += other.deadNs[beam];
+        }
+        muons += other.muons;
+    }
+
+    long long liveNs(int beam) const { return spanNs[beam] - deadNs[beam]; }
+    long long totalSpanNs() const { return spanNs[0] + spanNs[1]; }
+    long long totalDeadNs() const { return deadNs[0] + deadNs[1]; }
+};
+
+// Live time from the event stream. The beam channel is only sampled at
+// events, so each gap between consecutive events takes the beam state of
+// the event that opens it. Every muon vetoes the deadWindowNs that follow
+// it; overlapping windows are counted once, and a window left open at the
+// end of a run only counts up to its last event. Gaps between runs are not
+// exposure, so startRun() forgets the previous event but keeps the open
+// veto window, which carries over like the muons themselves. A job chunk
+// that starts inside a file picks up the previous chunk's run with
+// continueRun() instead, so the gap across the chunk boundary is kept.
+class LiveTimeTracker {
+public:
+    explicit LiveTimeTracker(long long deadWindowNs) : deadWindowNs_(deadWindowNs), deadUntilNs_(LLONG_MIN) {
+        run_.reset();
+        total_.reset();
+        startRun();
+    }
+
+    void startRun() {
+        previousNs_ = LLONG_MIN;
+        previousBeam_ = 0;
+    }
+
+    // Resume a run from its latest event, saved by an earlier job chunk
+    void continueRun(long long previousNs, int previousBeam) {
+        previousNs_ = previousNs;
+        previousBeam_ = previousBeam;
+    }
+
+    // Call once per event in time order; events out of order add no time
+    void addEvent(long long nowNs, bool beamOn, bool muon) {
+        if (previousNs_ != LLONG_MIN && nowNs > previousNs_) {
+            long long gap = nowNs - previousNs_;
+            long long dead = deadUntilNs_ > previousNs_ ? deadUntilNs_ - previousNs_ : 0;
+            run_.spanNs[previousBeam_] += gap;
+            run_.deadNs[previousBeam_] += dead < gap ? dead : gap;
+        }
+        if (nowNs >= previousNs_) {
+            previousNs_ = nowNs;
+            previousBeam_ = beamOn;
+        }
+        if (muon) {
+            run_.muons++;
+            if (nowNs + deadWindowNs_ > deadUntilNs_) deadUntilNs_ = nowNs + deadWindowNs_;
+        }
+    }
+
+    // Add the run to the job totals and return it
+    LiveTimeCounts endRun() {
+        LiveTimeCounts run = run_;
+        total_.add(run_);
+        run_.reset();
+        return run;
+    }
+
+    // Veto window of a muon from an earlier job chunk
+    void restoreMuon(long long muonNs) {
+        if (muonNs + deadWindowNs_ > deadUntilNs_) deadUntilNs_ = muonNs + deadWindowNs_;
+    }
+
+    // Drop the open veto window, e.g. when time goes backwards
+    void clearVeto() { deadUntilNs_ = LLONG_MIN; }
+
+    const LiveTimeCounts &total() const { return total_; }
+    long long previousNs() const { return previousNs_; }
+    int previousBeam() const { return previousBeam_; }
+
+private:
+    long long deadWindowNs_;
+    long long deadUntilNs_; // End of the latest muon veto window (ns)
+    long long previousNs_;  // Latest event of the run, LLONG_MIN before the first
+    int previousBeam_;
+    LiveTimeCounts run_;
+    LiveTimeCounts total_;
+};
+
+#endif
@@ -9,7 +9,12 @@
 #include <TMath.h>
 #include <TStyle.h>
 #include <TLegend.h>
+#include <TGraph.h>
+#include <TGaxis.h>
+#include <TPad.h>
 #include <TPaveStats.h>
+#include <TNamed.h>
+#include <TDirectory.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -17,28 +22,46 @@
 #include <algorithm>
 #include <string>
 #include <map>
-#include <set>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <ctime>
+#include <climits>
+#include <cstdlib>
+#include "EventKernel.h"
+#include "PulseFinder.h"
+#include "EventRecord.h"
+#include "MuonCorrelator.h"
+#include "SelectionConfig.h"
+#include "CutFlow.h"
+#include "SelectionProcessor.h"
+#include "LiveTime.h"
+#include "AnalysisConfig.h"
+#include "AllocationCounter.h"
 
 using std::cout;
 using std::endl;
 using namespace std;
 
 // Constants
-const int N_PMTS = 12;
-const int PMT_CHANNEL_MAP[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
 const int PULSE_THRESHOLD = 30;     // ADC threshold for pulse detection
 const int BS_UNCERTAINTY = 5;       // Baseline uncertainty (ADC)
-const int EV61_THRESHOLD = 1200;    // Beam on if channel 22 > this (ADC)
-const double MUON_ENERGY_THRESHOLD = 50; // Min PMT energy for muon (p.e.)
-const double MICHEL_ENERGY_MIN = 40;    // Min PMT energy for Michel (p.e.)
-const double MICHEL_ENERGY_MAX = 1000;  // Max PMT energy for Michel (p.e.)
+const int EV61_THRESHOLD = 1200;    // Beam on if the beam channel integral > this (ADC)
+const int LATE_PULSE_THRESHOLD = 100; // PMT pulse runs past the window if last sample > this (ADC)
+const int LATE_PULSE_MIN_PMTS = 10; // PMTs with late pulses for the relaxed muon criterion
+const int ADC_SATURATION = 16383;   // 14-bit digitizer full scale (ADC code)
+const double BASELINE_TOLERANCE = 5;    // Stored baseline overridden if off by more than this (ADC)
+const double BASELINE_QUIET_SPREAD = 20; // Max pre-pulse spread for a baseline update (ADC)
+const double NOISE_THRESHOLD_SIGMAS = 6; // Noise-adaptive pulse threshold in units of baselineRMS
 const double MICHEL_ENERGY_MAX_DT = 400; // Max PMT energy for dt plots (p.e.)
 const double MICHEL_DT_MIN = 0.8;       // Min time after muon for Michel (µs)
 const double MICHEL_DT_MAX = 16.0;      // Max time after muon for Michel (µs)
-const int ADCSIZE = 45;                 // Number of ADC samples per waveform
+const double MUON_DEAD_TIME = 16.0;     // Dead time after each muon, for live time (µs)
+// Muon: the selection's veto convention sees a muon, and over 50 p.e. (25 p.e. if the PMT pulses run past the window)
+const char *const MUON_CUTS = "muon_veto: veto_hit == 1; muon_energy: muon_energy > 50";
+// Michel: not a muon, 40-1000 p.e. in at least 8 PMTs, quiet veto, a muon in the dt window
+const char *const MICHEL_CUTS = "full_path: path == full; energy_min: energy >= 40; energy_max: energy <= 1000; "
+                                "multiplicity: multiplicity >= 8; veto_quiet: veto_quiet == 1; parent_muon: parents >= 1";
+const double PMT_HIT_THRESHOLDS[N_PMTS] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}; // Min pulse energy for a PMT hit (p.e.)
 
 // Generate unique output directory with timestamp
 string getTimestamp() {
@@ -50,36 +73,68 @@ string getTimestamp() {
 }
 const string OUTPUT_DIR = "./AnalysisOutput_" + getTimestamp();
 
-const std::vector<double> SIDE_VP_THRESHOLDS = {750, 950, 1200, 1375, 525, 700, 700, 500}; // Channels 12-19 (ADC)
-const double TOP_VP_THRESHOLD = 450; // Channels 20-21 (ADC)
+const int CALIBRATION_TRIGGERS[1] = {16};   // LED flashes: gain monitoring only
+const int MUON_ONLY_TRIGGERS[3] = {1, 4, 8}; // Beam and other triggers excluded from the Michel search
 const double FIT_MIN = 1.0; // Fit range min (µs)
 const double FIT_MAX = 10.0; // Fit range max (µs)
-
-// Pulse structure
-struct pulse {
-    double start;          // Start time (µs)
-    double end;            // End time (µs)
-    double peak;           // Max amplitude (p.e. for PMTs, ADC for SiPMs)
-    double energy;         // Energy (p.e. for PMTs, ADC for SiPMs)
-    double number;         // Number of channels with pulse
-    bool single;           // Timing consistency
-    bool beam;             // Beam status
-    double trigger;        // Trigger type
-    double side_vp_energy; // Side veto energy (ADC)
-    double top_vp_energy;  // Top veto energy (ADC)
-    double all_vp_energy;  // All veto energy (ADC)
-    double last_muon_time; // Time of last muon (µs)
-    bool is_muon;          // Muon candidate flag
-    bool is_michel;        // Michel electron candidate flag
+const double FIT_SCAN_END = 16.0; // End of the fit-start scan fits, when a config asks for the scan (µs)
+
+// Cut configurations that can be evaluated side by side in one pass (--selections).
+// "final" is this program's own cuts; the others reproduce the variant programs.
+// These and the constants above are the defaults that a --config file overrides.
+const SelectionConfig SELECTIONS[] = {
+    {"final", EV61_THRESHOLD, "panels", "pmts", MUON_CUTS, MICHEL_CUTS,
+     MICHEL_ENERGY_MAX_DT, MICHEL_DT_MIN, MICHEL_DT_MAX, MUON_DEAD_TIME,
+     {750, 950, 1200, 1375, 525, 700, 700, 500, TOP_VP_THRESHOLD, TOP_VP_THRESHOLD}, TOP_VP_THRESHOLD,
+     200, 160, 1000, 2000, "dt"},
+    // Michel Working WithHISt Style, oldmichel159600Result, withChisquareComparison159600: energy_vs_dt for every event
+    {"vp-dt076", 1200, "panels", "pulses", MUON_CUTS, MICHEL_CUTS, 400, 0.76, 16, MUON_DEAD_TIME,
+     {750, 950, 1200, 1375, 525, 700, 700, 500, 450, 450}, 450,
+     100, 200, 16, 1000, "all"},
+    // MichelEectronAnalysisNewVariableNames, withChiSquareComparision: any of the ten SiPMs, energy_vs_dt for every Michel
+    {"sipm-1100", 1100, "sipm", "pulses", MUON_CUTS, MICHEL_CUTS, 400, 0.76, 16, MUON_DEAD_TIME,
+     {750, 950, 1200, 1375, 525, 700, 700, 500, 450, 450}, 450,
+     100, 200, 16, 1000, "michel"},
+    // withPMTmutpliplicityWorking: energy_vs_dt for every Michel
+    {"sipm-1100-mult10", 1100, "sipm", "pmts", MUON_CUTS,
+     "full_path: path == full; energy_min: energy >= 40; energy_max: energy <= 1000; "
+     "multiplicity: multiplicity >= 10; veto_quiet: veto_quiet == 1; parent_muon: parents >= 1", 400, 0.75, 16, MUON_DEAD_TIME,
+     {700, 1000, 1200, 1400, 500, 700, 700, 500, 450, 450}, 450,
+     100, 200, 16, 1000, "michel"},
 };
-
-// Temporary pulse structure
-struct pulse_temp {
-    double start;  // Start time (µs)
-    double end;    // End time (µs)
-    double peak;   // Max amplitude
-    double energy; // Energy
+const int N_SELECTIONS = sizeof(SELECTIONS) / sizeof(SELECTIONS[0]);
+
+// Delayed windows searched after the muons of every selection (--windows)
+const DelayedWindowConfig DELAYED_WINDOWS[] = {
+    // Neutron-capture-like: 20-400 p.e. in at least 4 PMTs, quiet veto, 10-500 µs after a muon
+    {"neutron", "full_path: path == full; energy_min: energy >= 20; energy_max: energy <= 400; "
+                "multiplicity: multiplicity >= 4; veto_quiet: veto_quiet == 1; parent_muon: parents >= 1",
+     10, 500, 100, 400, 100},
 };
+const int N_DELAYED_WINDOWS = sizeof(DELAYED_WINDOWS) / sizeof(DELAYED_WINDOWS[0]);
+
+// Built-in configuration: the constants and the selection table above
+AnalysisConfig defaultAnalysisConfig() {
+    AnalysisConfig config;
+    config.pulseThreshold = PULSE_THRESHOLD;
+    config.baselineUncertainty = BS_UNCERTAINTY;
+    config.latePulseThreshold = LATE_PULSE_THRESHOLD;
+    config.latePulseMinPmts = LATE_PULSE_MIN_PMTS;
+    config.adcSaturation = ADC_SATURATION;
+    config.baselineTolerance = BASELINE_TOLERANCE;
+    config.baselineQuietSpread = BASELINE_QUIET_SPREAD;
+    config.noiseThresholdSigmas = NOISE_THRESHOLD_SIGMAS;
+    for (int i = 0; i < N_PMTS; i++) config.pmtHitThreshold[i] = PMT_HIT_THRESHOLDS[i];
+    config.calibrationTriggers.assign(CALIBRATION_TRIGGERS, CALIBRATION_TRIGGERS + 1);
+    config.muonOnlyTriggers.assign(MUON_ONLY_TRIGGERS, MUON_ONLY_TRIGGERS + 3);
+    config.fitMin = FIT_MIN;
+    config.fitMax = FIT_MAX;
+    config.fitScanStarts.clear();
+    config.fitScanEnd = FIT_SCAN_END;
+    config.selections.assign(SELECTIONS, SELECTIONS + N_SELECTIONS);
+    config.windows.assign(DELAYED_WINDOWS, DELAYED_WINDOWS + N_DELAYED_WINDOWS);
+    return config;
+}
 
 // SPE fitting function
 Double_t SPEfit(Double_t *x, Double_t *par) {
@@ -95,38 +150,118 @@ Double_t ExpFit(Double_t *x, Double_t *par) {
     return par[0] * exp(-x[0] / par[1]) + par[2];
 }
 
-// Utility functions
-template<typename T>
-double getAverage(const std::vector<T>& v) {
-    if (v.empty()) return 0;
-    return std::accumulate(v.begin(), v.end(), 0.0) / v.size();
-}
+// Fit the Michel dt histogram from each start time to end (µs) and compare
+// tau and chi2/NDF against the start, as the withChiSquareComparison
+// variants did: prints every fit and the best converged one, and saves the
+// comparison plot with tau on a second axis.
+void scanFitStart(TH1D *h_dt_michel, const vector<double> &fit_starts, double fit_end) {
+    if (h_dt_michel->GetEntries() <= 5) {
+        cout << "Skipping fit start comparison - insufficient entries in dt histogram" << endl;
+        return;
+    }
+    vector<double> taus, tau_errs, chi2ndfs;
+    int best_index = -1;
+    double min_chi2ndf = 1e9;
+    for (size_t i = 0; i < fit_starts.size(); i++) {
+        double fit_start = fit_starts[i];
+        TF1 *expFit_var = new TF1(Form("expFit_var_%.1f", fit_start), ExpFit, fit_start, fit_end, 3);
+
+        // Background from the smallest non-empty bin of the last 4 µs
+        double C_init = 0.1;
+        double min_content = 1e9;
+        for (int bin = h_dt_michel->FindBin(fit_end - 4); bin <= h_dt_michel->FindBin(fit_end); bin++) {
+            double content = h_dt_michel->GetBinContent(bin);
+            if (content > 0 && content < min_content) min_content = content;
+        }
+        if (min_content < 1e9) C_init = min_content;
 
-template<typename T>
-double mostFrequent(const std::vector<T>& v) {
-    if (v.empty()) return 0;
-    std::map<T, int> count;
-    for (const auto& val : v) count[val]++;
-    T most_common = v[0];
-    int max_count = 0;
-    for (const auto& pair : count) {
-        if (pair.second > max_count) {
-            max_count = pair.second;
-            most_common = pair.first;
+        double integral = h_dt_michel->Integral(h_dt_michel->FindBin(fit_start), h_dt_michel->FindBin(fit_end));
+        double bin_width = h_dt_michel->GetBinWidth(1);
+        double N0_init = (integral * bin_width - C_init * (fit_end - fit_start)) / 2.2;
+        if (N0_init < 0) N0_init = 100;
+        expFit_var->SetParameters(N0_init, 2.2, C_init);
+        expFit_var->SetParNames("N_{0}", "#tau", "C");
+        expFit_var->SetParLimits(0, 0, N0_init * 100);
+        expFit_var->SetParLimits(1, 0.1, 20.0);
+        expFit_var->SetParLimits(2, -C_init * 10, C_init * 10);
+
+        // Quiet, and not stored with the histogram
+        int fitStatus = h_dt_michel->Fit(expFit_var, "QRN+", "", fit_start, fit_end);
+        double tau = expFit_var->GetParameter(1);
+        double tau_err = expFit_var->GetParError(1);
+        int ndf = expFit_var->GetNDF();
+        double chi2ndf = ndf > 0 ? expFit_var->GetChisquare() / ndf : 999;
+        taus.push_back(tau);
+        tau_errs.push_back(tau_err);
+        chi2ndfs.push_back(chi2ndf);
+        if (chi2ndf < min_chi2ndf && fitStatus == 0) {
+            min_chi2ndf = chi2ndf;
+            best_index = static_cast<int>(i);
         }
+        cout << Form("Fit Range %.1f–%.1f µs:\n", fit_start, fit_end);
+        cout << "Fit Status: " << fitStatus << " (0 = success)\n";
+        cout << Form("τ = %.4f ± %.4f µs", tau, tau_err) << endl;
+        cout << Form("χ²/NDF = %.4f", chi2ndf) << endl;
+        cout << "----------------------------------------" << endl;
+        delete expFit_var;
     }
-    return max_count > 1 ? most_common : getAverage(v);
-}
-
-template<typename T>
-double variance(const std::vector<T>& v) {
-    if (v.size() <= 1) return 0;
-    double mean = getAverage(v);
-    double sum = 0;
-    for (const auto& val : v) {
-        sum += (val - mean) * (val - mean);
+    if (best_index >= 0) {
+        cout << Form("Best Fit Range: %.1f–%.1f µs\n", fit_starts[best_index], fit_end);
+        cout << Form("τ = %.4f ± %.4f µs", taus[best_index], tau_errs[best_index]) << endl;
+        cout << Form("χ²/NDF = %.4f (minimum)", chi2ndfs[best_index]) << endl;
+        cout << "----------------------------------------" << endl;
     }
-    return sum / (v.size() - 1);
+
+    // chi2/NDF on the left axis, tau scaled onto it with its own axis on the right
+    TCanvas *c_comp = new TCanvas("c_comp", "Fit Start Time Comparison", 1200, 800);
+    c_comp->SetGrid();
+    TPad *pad = new TPad("pad", "pad", 0, 0, 1, 1);
+    pad->Draw();
+    pad->cd();
+    int n = static_cast<int>(fit_starts.size());
+    TGraph *g_chi2 = new TGraph(n, fit_starts.data(), chi2ndfs.data());
+    TGraph *g_tau = new TGraph(n, fit_starts.data(), taus.data());
+    g_chi2->SetTitle("Fit Start Time Comparison");
+    g_chi2->GetXaxis()->SetTitle("Fit Start Time (#mus)");
+    g_chi2->GetYaxis()->SetTitle("#chi^{2}/ndf");
+    g_chi2->SetMarkerStyle(20);
+    g_chi2->SetMarkerColor(kBlue);
+    g_chi2->SetLineColor(kBlue);
+    g_chi2->SetLineWidth(2);
+    g_tau->SetMarkerStyle(22);
+    g_tau->SetMarkerColor(kRed);
+    g_tau->SetLineColor(kRed);
+    g_tau->SetLineWidth(2);
+    g_chi2->Draw("APL");
+    pad->Update();
+    double ymin = pad->GetUymin();
+    double ymax = pad->GetUymax();
+    double tau_min = *min_element(taus.begin(), taus.end());
+    double tau_max = *max_element(taus.begin(), taus.end());
+    double scale = tau_max > tau_min ? (ymax - ymin) / (tau_max - tau_min) : 1;
+    double offset = ymin - tau_min * scale;
+    for (int i = 0; i < n; i++) g_tau->SetPoint(i, fit_starts[i], taus[i] * scale + offset);
+    g_tau->Draw("PL same");
+    TGaxis *axis = new TGaxis(pad->GetUxmax(), ymin, pad->GetUxmax(), ymax, tau_min, tau_max, 510, "+L");
+    axis->SetLineColor(kRed);
+    axis->SetLabelColor(kRed);
+    axis->SetTitle("#tau (#mus)");
+    axis->SetTitleColor(kRed);
+    axis->Draw();
+    TLegend *leg = new TLegend(0.7, 0.7, 0.9, 0.9);
+    leg->AddEntry(g_chi2, "#chi^{2}/ndf", "lp");
+    leg->AddEntry(g_tau, "#tau", "lp");
+    leg->Draw();
+    string compPlotName = OUTPUT_DIR + "/FitStartComparison.png";
+    c_comp->SaveAs(compPlotName.c_str());
+    cout << "Saved comparison plot: " << compPlotName << endl;
+
+    delete g_chi2;
+    delete g_tau;
+    delete leg;
+    delete axis;
+    delete pad;
+    delete c_comp;
 }
 
 // Create output directory
@@ -177,8 +312,9 @@ void performCalibration(const string &calibFileName, Double_t *mu1, Double_t *mu
     for (Long64_t entry = 0; entry < nEntries; entry++) {
         calibTree->GetEntry(entry);
         if (triggerBits != 16) continue;
-        for (int pmt = 0; pmt < N_PMTS; pmt++) {
-            histArea[pmt]->Fill(area[PMT_CHANNEL_MAP[pmt]]);
+        for (int iChan = PMT_CHANNELS.first; iChan < PMT_CHANNELS.end; iChan++) {
+            int pmt = CHANNEL_LAYOUT[iChan].slot;
+            histArea[pmt]->Fill(area[iChan]);
             nLEDFlashes[pmt]++;
         }
     }
@@ -229,22 +365,395 @@ void performCalibration(const string &calibFileName, Double_t *mu1, Double_t *mu
     calibFile->Close();
 }
 
+// Muon-Michel histograms, kept for a whole selection and for each category
+// it is split into
+struct AnalysisHistograms {
+    TH1D *h_muon_energy;
+    TH1D *h_michel_energy;
+    TH1D *h_dt_michel;
+    TH2D *h_energy_vs_dt;
+
+    void createAnalysisHistograms(const SelectionConfig &cfg, const string &suffix, const string &title) {
+        h_muon_energy = new TH1D(("muon_energy" + suffix).c_str(), ("Muon Energy Distribution (with Michel Electrons)" + title + ";Energy (p.e.);Counts/100 p.e.").c_str(), 550, -500, 5000);
+        h_michel_energy = new TH1D(("michel_energy" + suffix).c_str(), ("Michel Electron Energy Distribution" + title + Form(";Energy (p.e.);Counts/%g p.e.", 800.0 / cfg.michelEnergyBins)).c_str(), cfg.michelEnergyBins, 0, 800);
+        h_dt_michel = new TH1D(("DeltaT" + suffix).c_str(), ("Muon-Michel Time Difference" + title + Form(" ;Time to Previous event(Muon)(#mus);Counts/%g #mus", cfg.michelDtMax / cfg.dtBins)).c_str(), cfg.dtBins, 0, cfg.michelDtMax);
+        h_energy_vs_dt = new TH2D(("energy_vs_dt" + suffix).c_str(), ("Michel Energy vs Time Difference" + title + ";dt (#mus);Energy (p.e.)").c_str(), 160, 0, cfg.energyVsDtMaxDt, 200, 0, cfg.energyVsDtMaxEnergy);
+        // Category sets are created mid-run, while an input file is the current
+        // directory; detach them all so closing the file does not delete them
+        h_muon_energy->SetDirectory(nullptr);
+        h_michel_energy->SetDirectory(nullptr);
+        h_dt_michel->SetDirectory(nullptr);
+        h_energy_vs_dt->SetDirectory(nullptr);
+    }
+
+    void writeAnalysisHistograms() const {
+        h_muon_energy->Write();
+        h_michel_energy->Write();
+        h_dt_michel->Write();
+        h_energy_vs_dt->Write();
+    }
+
+    void deleteAnalysisHistograms() {
+        delete h_muon_energy;
+        delete h_michel_energy;
+        delete h_dt_michel;
+        delete h_energy_vs_dt;
+    }
+};
+
+// Histograms and per-run count of one delayed window in one selection
+struct WindowHistograms {
+    long candidates;
+    TH1D *h_delayed_energy;
+    TH1D *h_delayed_dt;
+    TH1D *h_delayed_multiplicity;
+};
+
+const int N_TRIGGER_CATEGORIES = N_TRIGGER_CODES + 1; // One per trigger code, the last for codes outside the table
+
+// One cut configuration being evaluated: the processor state (see
+// SelectionProcessor) plus its own counters and histograms. The primary
+// selection keeps the plain histogram names; the others get the
+// configuration name appended.
+struct Selection : SelectionCore, AnalysisHistograms {
+    long num_muons;          // Per-run counters
+    long num_michels;
+    long tagged_muons;
+    long multi_parent_michels;
+    long beam_events;
+    LiveTimeTracker liveTime; // Exposure per run and for the job
+    string suffix;           // Histogram name and title additions of this selection
+    string title;
+    AnalysisHistograms *categories[2][N_TRIGGER_CATEGORIES]; // By beam flag and trigger code, null until filled
+    vector<WindowHistograms> windowHistograms; // Parallel to windows
+    TH1D *h_side_vp_muon;
+    TH1D *h_top_vp_muon;
+    TH1D *h_pmt_multiplicity;
+    TH1D *h_pmt_hit_pattern;
+    TH1D *h_livetime;
+    int energyVsDtFill; // ENERGY_VS_DT_*
+
+    Selection(const SelectionConfig &cfg, bool primary)
+        : SelectionCore(cfg), liveTime(static_cast<long long>(cfg.muonDeadTime * 1000)),
+          energyVsDtFill(energyVsDtFillCode(cfg.energyVsDtFill)) {
+        // Keep muons for the whole dead time, so the state carried to the next
+        // chunk holds every muon whose veto window is still open
+        muonWindow.extend(static_cast<long long>(cfg.muonDeadTime * 1000));
+        // Every event against the latest muon needs the muons across the whole plot
+        if (energyVsDtFill == ENERGY_VS_DT_ALL) muonWindow.extend(static_cast<long long>(cfg.energyVsDtMaxDt * 1000));
+        resetCounters();
+        suffix = primary ? "" : string("_") + cfg.name;
+        title = primary ? "" : string(" [") + cfg.name + "]";
+        for (int beam = 0; beam < 2; beam++) {
+            for (int trigger = 0; trigger < N_TRIGGER_CATEGORIES; trigger++) categories[beam][trigger] = nullptr;
+        }
+        createAnalysisHistograms(cfg, suffix, title);
+        h_side_vp_muon = new TH1D(("side_vp_muon" + suffix).c_str(), ("Side Veto Energy for Muons" + title + ";Energy (ADC);Counts").c_str(), 200, 0, 5000);
+        h_top_vp_muon = new TH1D(("top_vp_muon" + suffix).c_str(), ("Top Veto Energy for Muons" + title + ";Energy (ADC);Counts").c_str(), 200, 0, 1000);
+        h_pmt_multiplicity = new TH1D(("pmt_multiplicity" + suffix).c_str(), ("PMT Multiplicity for Michel Electrons" + title + ";Number of PMTs;Counts").c_str(), 13, 0, 13);
+        h_pmt_hit_pattern = new TH1D(("pmt_hit_pattern" + suffix).c_str(), ("PMT Hits for Michel Electrons" + title + ";PMT;Counts").c_str(), 12, 0.5, 12.5);
+        // Seconds per bin, so chunks merged with hadd add up to the job's exposure
+        h_livetime = new TH1D(("livetime" + suffix).c_str(), ("Exposure" + title + ";;Time (s)").c_str(), 7, 0, 7);
+        const char *const labels[] = {"span", "beam_on", "beam_off", "dead_beam_on", "dead_beam_off", "live_beam_on", "live_beam_off"};
+        for (int i = 0; i < 7; i++) h_livetime->GetXaxis()->SetBinLabel(i + 1, labels[i]);
+    }
+
+    // Search a delayed window with its own histograms
+    void addWindow(const DelayedWindowConfig &w) {
+        SelectionCore::addWindow(w);
+        string name = "_" + w.name + suffix;
+        string label = " (" + w.name + " window)" + title;
+        WindowHistograms h;
+        h.candidates = 0;
+        h.h_delayed_energy = new TH1D(("delayed_energy" + name).c_str(), ("Delayed Event Energy" + label + Form(";Energy (p.e.);Counts/%g p.e.", w.maxEnergy / w.energyBins)).c_str(), w.energyBins, 0, w.maxEnergy);
+        h.h_delayed_dt = new TH1D(("delayed_dt" + name).c_str(), ("Muon-Delayed Event Time Difference" + label + Form(";Time to Previous event(Muon)(#mus);Counts/%g #mus", w.dtMax / w.dtBins)).c_str(), w.dtBins, 0, w.dtMax);
+        h.h_delayed_multiplicity = new TH1D(("delayed_multiplicity" + name).c_str(), ("PMT Multiplicity for Delayed Events" + label + ";Number of PMTs;Counts").c_str(), 13, 0, 13);
+        windowHistograms.push_back(h);
+    }
+
+    // Histograms for the event's beam flag and trigger code, created the
+    // first time the category is seen, so only categories present in the
+    // data cost memory. A muon-Michel pair goes in the Michel's category.
+    AnalysisHistograms &category(const HotEvent &ev) {
+        int beam = (ev.flags & EVENT_BEAM) ? 1 : 0;
+        int trigger = ev.trigger < N_TRIGGER_CODES ? ev.trigger : N_TRIGGER_CODES;
+        AnalysisHistograms *&h = categories[beam][trigger];
+        if (!h) {
+            string code = trigger < N_TRIGGER_CODES ? std::to_string(trigger) : string("other");
+            h = new AnalysisHistograms;
+            h->createAnalysisHistograms(*config, suffix + (beam ? "_beam_on" : "_beam_off") + "_trig" + code,
+                                        title + " [beam " + (beam ? "on" : "off") + ", trigger " + code + "]");
+        }
+        return *h;
+    }
+
+    // Job exposure into h_livetime
+    void fillLiveTime() {
+        const LiveTimeCounts &t = liveTime.total();
+        const double values[] = {static_cast<double>(t.totalSpanNs()), static_cast<double>(t.spanNs[1]),
+                                 static_cast<double>(t.spanNs[0]), static_cast<double>(t.deadNs[1]),
+                                 static_cast<double>(t.deadNs[0]), static_cast<double>(t.liveNs(1)),
+                                 static_cast<double>(t.liveNs(0))};
+        for (int i = 0; i < 7; i++) h_livetime->SetBinContent(i + 1, values[i] * 1e-9);
+    }
+
+    void resetCounters() {
+        muonCuts.resetCounts();
+        michelCuts.resetCounts();
+        num_muons = 0;
+        num_michels = 0;
+        tagged_muons = 0;
+        multi_parent_michels = 0;
+        beam_events = 0;
+        for (size_t w = 0; w < windows.size(); w++) {
+            windows[w].cuts.resetCounts();
+            windowHistograms[w].candidates = 0;
+        }
+    }
+
+    void writeHistograms() const {
+        writeAnalysisHistograms();
+        h_side_vp_muon->Write();
+        h_top_vp_muon->Write();
+        h_pmt_multiplicity->Write();
+        h_pmt_hit_pattern->Write();
+        h_livetime->Write();
+        for (const WindowHistograms &h : windowHistograms) {
+            h.h_delayed_energy->Write();
+            h.h_delayed_dt->Write();
+            h.h_delayed_multiplicity->Write();
+        }
+        for (int beam = 0; beam < 2; beam++) {
+            for (int trigger = 0; trigger < N_TRIGGER_CATEGORIES; trigger++) {
+                if (categories[beam][trigger]) categories[beam][trigger]->writeAnalysisHistograms();
+            }
+        }
+    }
+
+    void deleteHistograms() {
+        deleteAnalysisHistograms();
+        delete h_side_vp_muon;
+        delete h_top_vp_muon;
+        delete h_pmt_multiplicity;
+        delete h_pmt_hit_pattern;
+        delete h_livetime;
+        for (WindowHistograms &h : windowHistograms) {
+            delete h.h_delayed_energy;
+            delete h.h_delayed_dt;
+            delete h.h_delayed_multiplicity;
+        }
+        for (int beam = 0; beam < 2; beam++) {
+            for (int trigger = 0; trigger < N_TRIGGER_CATEGORIES; trigger++) {
+                if (!categories[beam][trigger]) continue;
+                categories[beam][trigger]->deleteAnalysisHistograms();
+                delete categories[beam][trigger];
+            }
+        }
+    }
+};
+
+// Correlator state file of one selection, path.<name>. Named, not
+// positional, so a later chunk with a different --selections list still
+// restores each selection's own muons.
+string selectionStateFile(const string &path, const Selection &sel) {
+    return path + "." + sel.config->name;
+}
+
+// Candidate list as a tree, one entry per event, so it merges with hadd like
+// the histograms. Create it in the output file before the first run; ROOT
+// then writes it out basket by basket as runs are flushed into it.
+struct CandidateTree {
+    TTree *tree;
+    HotEvent hot;
+    ColdEvent cold;
+
+    void create() {
+        tree = new TTree("candidates", "Muon and Michel candidates of the primary selection");
+        tree->Branch("startNs", &hot.startNs, "startNs/L");
+        tree->Branch("energy", &hot.energy, "energy/F");
+        tree->Branch("sideVetoEnergy", &hot.sideVetoEnergy, "sideVetoEnergy/F");
+        tree->Branch("topVetoEnergy", &hot.topVetoEnergy, "topVetoEnergy/F");
+        tree->Branch("pmtMask", &hot.pmtMask, "pmtMask/s");
+        tree->Branch("vetoMask", &hot.vetoMask, "vetoMask/s");
+        tree->Branch("trigger", &hot.trigger, "trigger/b");
+        tree->Branch("flags", &hot.flags, "flags/b");
+        tree->Branch("end", &cold.end, "end/D");
+        tree->Branch("peak", &cold.peak, "peak/D");
+        tree->Branch("lateMask", &cold.lateMask, "lateMask/i");
+        tree->Branch("saturatedMask", &cold.saturatedMask, "saturatedMask/i");
+        tree->Branch("clippedMask", &cold.clippedMask, "clippedMask/i");
+        tree->Branch("eventID", &cold.eventID, "eventID/I");
+    }
+
+    // Append one run's candidates and empty the store for the next run
+    void flush(EventStore &store) {
+        for (size_t i = 0; i < store.size(); i++) {
+            hot = store.hot(i);
+            cold = store.cold[i];
+            tree->Fill();
+        }
+        store.clear();
+    }
+};
+
+// Indices of the comma-separated names in a configuration table, each once;
+// false and a message listing the known names if one is unknown
+template <class Config>
+bool indexByName(const string &names, const vector<Config> &table, const char *what, vector<int> &index) {
+    size_t begin = 0;
+    while (begin <= names.size()) {
+        size_t comma = names.find(',', begin);
+        if (comma == string::npos) comma = names.size();
+        string name = names.substr(begin, comma - begin);
+        int i = findConfig(table, name);
+        if (i < 0) {
+            cerr << "Error: Unknown " << what << " " << name << " (known:";
+            for (const Config &known : table) cerr << " " << known.name;
+            cerr << ")" << endl;
+            return false;
+        }
+        if (std::find(index.begin(), index.end(), i) == index.end()) index.push_back(i);
+        begin = comma + 1;
+    }
+    return true;
+}
+
+// Entry range "FIRST:END" or "FIRST:" (to the last entry); false and a message
+// unless both are whole non-negative numbers with FIRST <= END
+bool parseEntryRange(const string &text, long long &first, long long &end) {
+    size_t colon = text.find(':');
+    if (colon != string::npos) {
+        string firstText = text.substr(0, colon), endText = text.substr(colon + 1);
+        char *parsed = nullptr;
+        first = strtoll(firstText.c_str(), &parsed, 10);
+        bool ok = !firstText.empty() && *parsed == '\0' && first >= 0;
+        end = LLONG_MAX;
+        if (ok && !endText.empty()) {
+            end = strtoll(endText.c_str(), &parsed, 10);
+            ok = *parsed == '\0' && end >= first;
+        }
+        if (ok) return true;
+    }
+    cerr << "Error: --entries expects FIRST:END with 0 <= FIRST <= END, got '" << text << "'" << endl;
+    return false;
+}
+
 int main(int argc, char *argv[]) {
-    // Parse command-line arguments
-    if (argc < 3) {
-        cout << "Usage: " << argv[0] << " <calibration_file> <input_file1> [<input_file2> ...]" << endl;
+    // Parse command-line arguments; options may appear anywhere
+    vector<string> positional;
+    string pulseFinderName = "threshold";
+    bool useFixedPoint = false;      // Integer front end
+    bool validateFixedPoint = false; // Also run the double front end and report the deviation
+    bool trackBaseline = false;      // Re-estimate baselines from the pre-pulse samples
+    bool noiseThresholds = false;    // Per-channel pulse thresholds from baselineRMS
+    bool allMichelPairs = false;     // Fill dt for every muon in the window, not just the nearest
+    bool splitCategories = true;     // Also fill the Michel histograms by beam flag and trigger code
+    string stateIn, stateOut;        // Correlator state prefix carried in from / out to another job (PREFIX.<selection>)
+    string configFile;               // Settings and selections replacing the built-in ones
+    string selectionNames;           // Cut configurations to evaluate, the first one plotted; default the first defined
+    string windowNames = "all";      // Delayed windows to search: all, none or a list
+    long long entryFirst = 0;        // Entry range over all input files in order, [first, end)
+    long long entryEnd = LLONG_MAX;
+    bool badOption = false;          // An option value did not parse; print the usage
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--pulse-finder=", 0) == 0) {
+            pulseFinderName = arg.substr(15);
+        } else if (arg == "--fixed-point") {
+            useFixedPoint = true;
+        } else if (arg == "--validate-fixed-point") {
+            useFixedPoint = true;
+            validateFixedPoint = true;
+        } else if (arg == "--track-baseline") {
+            trackBaseline = true;
+        } else if (arg == "--noise-thresholds") {
+            noiseThresholds = true;
+        } else if (arg == "--all-michel-pairs") {
+            allMichelPairs = true;
+        } else if (arg == "--no-categories") {
+            splitCategories = false;
+        } else if (arg.rfind("--config=", 0) == 0) {
+            configFile = arg.substr(9);
+        } else if (arg.rfind("--selections=", 0) == 0) {
+            selectionNames = arg.substr(13);
+        } else if (arg.rfind("--windows=", 0) == 0) {
+            windowNames = arg.substr(10);
+        } else if (arg.rfind("--state-in=", 0) == 0) {
+            stateIn = arg.substr(11);
+        } else if (arg.rfind("--state-out=", 0) == 0) {
+            stateOut = arg.substr(12);
+        } else if (arg.rfind("--entries=", 0) == 0) {
+            if (!parseEntryRange(arg.substr(10), entryFirst, entryEnd)) badOption = true;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (badOption || positional.size() < 2) {
+        cout << "Usage: " << argv[0] << " [--pulse-finder=threshold|cfd|matched] [--fixed-point|--validate-fixed-point] [--track-baseline] [--noise-thresholds] [--all-michel-pairs] [--no-categories] [--config=FILE] [--selections=all|NAME,...] [--windows=all|none|NAME,...] [--entries=FIRST:END] [--state-in=PREFIX] [--state-out=PREFIX] <calibration_file> <input_file1> [<input_file2> ...]" << endl;
+        return -1;
+    }
+
+    string calibFileName = positional[0];
+    vector<string> inputFiles(positional.begin() + 1, positional.end());
+
+    // Analysis settings: built in, or read and validated from --config
+    AnalysisConfig config = defaultAnalysisConfig();
+    if (!configFile.empty()) {
+        string error;
+        if (!readAnalysisConfig(configFile, defaultAnalysisConfig(), config, error)) {
+            cerr << "Error in configuration: " << error << endl;
+            return -1;
+        }
+    }
+    const string configText = analysisConfigText(config);
+    const uint64_t configHashValue = configHash(configText);
+    const string configHashText = configHashString(configHashValue);
+
+    PulseFinder *pulseFinder = makePulseFinder(pulseFinderName, config.baselineUncertainty);
+    if (!pulseFinder) {
+        cerr << "Error: Unknown pulse finder " << pulseFinderName << endl;
+        return -1;
+    }
+
+    // Cut configurations, each evaluated on the same reconstructed events
+    vector<int> selectionIndex;
+    if (selectionNames.empty()) {
+        selectionIndex.push_back(0);
+    } else if (selectionNames == "all") {
+        for (size_t i = 0; i < config.selections.size(); i++) selectionIndex.push_back(static_cast<int>(i));
+    } else if (!indexByName(selectionNames, config.selections, "selection", selectionIndex)) {
         return -1;
     }
 
-    string calibFileName = argv[1];
-    vector<string> inputFiles;
-    for (int i = 2; i < argc; i++) {
-        inputFiles.push_back(argv[i]);
+    // Delayed windows, each searched in every selection
+    vector<int> windowIndex;
+    if (windowNames == "all") {
+        for (size_t i = 0; i < config.windows.size(); i++) windowIndex.push_back(static_cast<int>(i));
+    } else if (windowNames != "none" && !indexByName(windowNames, config.windows, "window", windowIndex)) {
+        return -1;
     }
 
     // Create output directory
     createOutputDirectory(OUTPUT_DIR);
 
+    // The effective configuration goes next to the outputs, its hash into each of them
+    string configOutName = OUTPUT_DIR + "/config.txt";
+    ofstream configOut(configOutName.c_str());
+    configOut << "# Configuration hash " << configHashText << "\n" << configText;
+    configOut.close();
+    if (!configOut) {
+        cerr << "Error writing " << configOutName << endl;
+        return -1;
+    }
+
+    cout << "Pulse finder: " << pulseFinder->name() << endl;
+    cout << "Front end: " << (useFixedPoint ? "fixed point" : "double") << (validateFixedPoint ? " (validating against double)" : "") << endl;
+    cout << "Pulse thresholds: " << (noiseThresholds ? "max(floor, k x mean baselineRMS of the run) per channel" : "flat") << endl;
+    cout << "Baselines: " << (trackBaseline ? "stored, checked against pre-pulse samples" : "stored") << endl;
+    cout << "Configuration: " << (configFile.empty() ? "built in" : configFile) << " (hash " << configHashText << ")" << endl;
+    cout << "Selections:";
+    for (int index : selectionIndex) cout << " " << config.selections[index].name;
+    cout << endl;
     cout << "Calibration file: " << calibFileName << endl;
     cout << "Input files:" << endl;
     for (const auto& file : inputFiles) {
@@ -280,24 +789,67 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < N_PMTS; i++) {
         cout << "PMT " << i + 1 << ": mu1 = " << mu1[i] << " ± " << mu1_err[i] << " ADC counts/p.e.\n";
     }
+    const CalibrationTable cal = buildCalibrationTable(mu1);
+    const FrontEndSettings frontEndSettings = makeFrontEndSettings(config.pulseThreshold, config.baselineUncertainty,
+                                                                   config.latePulseThreshold, config.adcSaturation);
+    BaselineTracker baselineTracker(config.baselineTolerance, config.baselineQuietSpread);
+    vector<Selection> selections;
+    selections.reserve(selectionIndex.size());
+    for (int index : selectionIndex) {
+        selections.emplace_back(config.selections[index], selections.empty());
+        for (int window : windowIndex) selections.back().addWindow(config.windows[window]);
+        string error;
+        if (!selections.back().compileCuts(error)) {
+            cerr << "Error in selection " << config.selections[index].name << ": " << error << endl;
+            return -1;
+        }
+    }
+    if (!stateIn.empty()) {
+        for (size_t iSel = 0; iSel < selections.size(); iSel++) {
+            string stateFile = selectionStateFile(stateIn, selections[iSel]);
+            CorrelatorState state;
+            if (!readCorrelatorState(stateFile, state)) {
+                cerr << "Error reading correlator state: " << stateFile << endl;
+                return -1;
+            }
+            if (state.configHash != configHashValue) {
+                cerr << "Error: " << stateFile << " was written with configuration " << configHashString(state.configHash)
+                     << ", this job uses " << configHashText << endl;
+                return -1;
+            }
+            selections[iSel].muonWindow.restoreState(state);
+            for (int i = 0; i < state.nMuons; i++) selections[iSel].liveTime.restoreMuon(state.muons[i].startNs);
+            selections[iSel].liveTime.continueRun(state.runLastNs, state.runLastBeam);
+            cout << "Restored " << state.nMuons << " muons from " << stateFile << endl;
+        }
+    }
+    long long entryOffset = 0; // Entries in the input files before the current one
+    bool resumingChunk = !stateIn.empty(); // The first file read may continue the previous chunk's run
+    const TriggerDispatch dispatch = buildTriggerDispatch(config.calibrationTriggers.data(), static_cast<int>(config.calibrationTriggers.size()),
+                                                          config.muonOnlyTriggers.data(), static_cast<int>(config.muonOnlyTriggers.size()));
 
     // Statistics counters
-    int num_muons = 0;
-    int num_michels = 0;
     int num_events = 0;
 
     // Map to track triggerBits counts
     std::map<int, int> trigger_counts;
 
-    // Define histograms
-    TH1D* h_muon_energy = new TH1D("muon_energy", "Muon Energy Distribution (with Michel Electrons);Energy (p.e.);Counts/100 p.e.", 550, -500, 5000);
-    TH1D* h_michel_energy = new TH1D("michel_energy", "Michel Electron Energy Distribution;Energy (p.e.);Counts/4 p.e.", 200, 0, 800);
-    TH1D* h_dt_michel = new TH1D("DeltaT", "Muon-Michel Time Difference ;Time to Previous event(Muon)(#mus);Counts/0.1 #mus", 160, 0, MICHEL_DT_MAX);
-    TH2D* h_energy_vs_dt = new TH2D("energy_vs_dt", "Michel Energy vs Time Difference;dt (#mus);Energy (p.e.)", 160, 0, 1000, 200, 0, 2000);
-    TH1D* h_side_vp_muon = new TH1D("side_vp_muon", "Side Veto Energy for Muons;Energy (ADC);Counts", 200, 0, 5000);
-    TH1D* h_top_vp_muon = new TH1D("top_vp_muon", "Top Veto Energy for Muons;Energy (ADC);Counts", 200, 0, 1000);
+    // Define histograms; the per-selection ones live in each Selection
     TH1D* h_trigger_bits = new TH1D("trigger_bits", "Trigger Bits Distribution;Trigger Bits;Counts", 36, 0, 36);
 
+    // Output file, opened before the first run so the candidate tree goes to disk run by run
+    string histFileName = OUTPUT_DIR + "/histograms.root";
+    TDirectory *inputDirectory = gDirectory;
+    TFile *histFile = TFile::Open(histFileName.c_str(), "RECREATE");
+    if (!histFile || histFile->IsZombie()) {
+        cerr << "Error creating " << histFileName << endl;
+        return -1;
+    }
+    CandidateTree candidateTree;
+    candidateTree.create();
+    inputDirectory->cd();
+    EventStore candidates; // This run's muons and Michels of the primary selection, with their cold attributes
+
     for (const auto& inputFileName : inputFiles) {
         // Check if input file exists
         if (gSystem->AccessPathName(inputFileName.c_str())) {
@@ -339,15 +891,75 @@ int main(int argc, char *argv[]) {
         t->SetBranchAddress("nsTime", &nsTime);
         t->SetBranchAddress("triggerBits", &triggerBits);
 
+        // This file's part of the requested entry range
         int numEntries = t->GetEntries();
-        cout << "Processing " << numEntries << " entries in " << inputFileName << endl;
-        double last_muon_time = 0.0;
-        std::set<double> michel_muon_times;
-        std::vector<std::pair<double, double>> muon_candidates;
-
-        // First pass: Identify Michel electrons and their muon times
-        for (int iEnt = 0; iEnt < numEntries; iEnt++) {
-            t->GetEntry(iEnt);
+        int firstEntry = static_cast<int>(std::min(std::max(entryFirst - entryOffset, 0LL), static_cast<long long>(numEntries)));
+        int endEntry = static_cast<int>(std::min(std::max(entryEnd - entryOffset, 0LL), static_cast<long long>(numEntries)));
+        entryOffset += numEntries;
+        if (firstEntry >= endEntry) {
+            cout << "No entries in the requested range in " << inputFileName << endl;
+            f->Close();
+            continue;
+        }
+        cout << "Processing entries " << firstEntry << " to " << endEntry - 1 << " of " << numEntries << " in " << inputFileName << endl;
+        bool time_order_checked = false; // Muons carry over from the previous file only if time moves forward
+        // A chunk that starts inside a file continues the run the previous chunk left open
+        if (!(resumingChunk && firstEntry > 0)) {
+            for (Selection &sel : selections) sel.liveTime.startRun();
+        }
+        resumingChunk = false;
+        EventWorkspace &ws = eventWorkspace();
+        EventBatch<EVENT_BATCH_SIZE> &batch = eventBatch();
+        FrontEndBatch<EVENT_BATCH_SIZE> &fe = frontEndBatch();
+        long reco_allocations = 0;
+        double max_fixed_deviation = 0;
+        FixedPointComparison fixed_comparison; // Pulses found after each front end, with --validate-fixed-point
+        fixed_comparison.reset();
+        long num_pulses = 0;
+        long applied_pulses = 0, flat_pulses = 0; // Threshold-finder pulses at the applied and the flat thresholds
+        baselineTracker.reset();
+        FrontEndSettings runSettings = frontEndSettings;
+        unsigned int raised_thresholds = 0;
+        if (noiseThresholds) {
+            // Thresholds for the whole run from its mean noise, reading only the baselineRMS branch first
+            double run_rms[N_CHANNELS] = {0};
+            TBranch *rmsBranch = t->GetBranch("baselineRMS");
+            for (int jEnt = firstEntry; jEnt < endEntry; jEnt++) {
+                rmsBranch->GetEntry(jEnt);
+                for (int iChan = 0; iChan < N_CHANNELS; iChan++) run_rms[iChan] += baselineRMS[iChan];
+            }
+            for (int iChan = 0; iChan < N_CHANNELS; iChan++) run_rms[iChan] /= endEntry - firstEntry;
+            raised_thresholds = applyNoiseThresholds(runSettings, run_rms, config.noiseThresholdSigmas);
+        }
+        long path_counts[N_EVENT_PATHS] = {0};
+        double led_charge[N_PMTS] = {0}; // Summed LED charge per PMT (p.e.)
+
+        // Single pass: tag muons, then Michel electrons against the recent muons
+        for (int iEnt = firstEntry; iEnt < endEntry; iEnt++) {
+            // Read the next batch of events and run the front end across them
+            int lane = (iEnt - firstEntry) % EVENT_BATCH_SIZE;
+            if (lane == 0) {
+                batch.clear();
+                for (int jEnt = iEnt; jEnt < endEntry && !batch.full(); jEnt++) {
+                    t->GetEntry(jEnt);
+                    batch.add(adcVal, baselineMean, nsTime, triggerBits, eventID);
+                }
+                if (trackBaseline) baselineTracker.apply(batch);
+                if (validateFixedPoint) {
+                    FrontEndBatch<EVENT_BATCH_SIZE> &ref = referenceFrontEndBatch();
+                    runFrontEnd(batch, runSettings, ref);
+                    runFrontEndFixed(batch, runSettings, fe);
+                    max_fixed_deviation = std::max(max_fixed_deviation, maxFixedPointDeviation(fe, ref, batch.nEvents));
+                    comparePulsePaths(*pulseFinder, batch, fe, ref, fixed_comparison);
+                } else if (useFixedPoint) {
+                    runFrontEndFixed(batch, runSettings, fe);
+                } else {
+                    runFrontEnd(batch, runSettings, fe);
+                }
+            }
+            nsTime = batch.nsTime[lane];
+            triggerBits = batch.triggerBits[lane];
+            eventID = batch.eventID[lane];
             num_events++;
 
             // Fill triggerBits histogram and track counts
@@ -358,221 +970,308 @@ int main(int argc, char *argv[]) {
                 cout << "Warning: triggerBits = " << triggerBits << " out of histogram range (0–31) in file " << inputFileName << ", event " << eventID << endl;
             }
 
-            // Initialize pulse
-            struct pulse p;
-            p.start = nsTime / 1000.0; // Convert ns to µs
-            p.end = nsTime / 1000.0;
-            p.peak = 0;
-            p.energy = 0;
-            p.number = 0;
-            p.single = false;
-            p.beam = false;
-            p.trigger = triggerBits;
-            p.side_vp_energy = 0;
-            p.top_vp_energy = 0;
-            p.all_vp_energy = 0;
-            p.last_muon_time = last_muon_time;
-            p.is_muon = false;
-            p.is_michel = false;
-
-            std::vector<double> all_chan_start, all_chan_end, all_chan_peak, all_chan_energy;
-            std::vector<double> side_vp_energy, top_vp_energy;
-            std::vector<double> chan_starts_no_outliers;
-            TH1D h_wf("h_wf", "Waveform", ADCSIZE, 0, ADCSIZE);
-
-            bool pulse_at_end = false;
-            int pulse_at_end_count = 0;
-            std::vector<double> veto_energies(10, 0); // Channels 12-21
-
-            for (int iChan = 0; iChan < 23; iChan++) {
-                // Fill waveform histogram
-                for (int i = 0; i < ADCSIZE; i++) {
-                    h_wf.SetBinContent(i + 1, adcVal[iChan][i] - baselineMean[iChan]);
+            // Route by trigger before any per-channel work
+            unsigned char path = dispatch.route(triggerBits);
+            path_counts[path]++;
+            if (path == PATH_CALIBRATION) {
+                for (int iChan = PMT_CHANNELS.first; iChan < PMT_CHANNELS.end; iChan++) {
+                    const ChannelDescriptor &d = CHANNEL_LAYOUT[iChan];
+                    led_charge[d.slot] += fe.integral(iChan, lane, d.firstBin, d.lastBin) * cal.energyScale[iChan];
                 }
+                continue;
+            }
+            bool fullPath = path == PATH_FULL;
+            for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+                applied_pulses += fe.pulseCount[iChan][lane];
+                flat_pulses += fe.flatPulseCount[iChan][lane];
+            }
 
-                // Check beam status (channel 22)
-                if (iChan == 22) {
-                    double ev61_energy = 0;
-                    for (int iBin = 1; iBin <= ADCSIZE; iBin++) {
-                        ev61_energy += h_wf.GetBinContent(iBin);
-                    }
-                    if (ev61_energy > EV61_THRESHOLD) {
-                        p.beam = true;
-                    }
+            long allocations_before = heapAllocations();
+            ws.reset();
+
+            // Pulse finding for one channel, skipped when no sample reaches its threshold.
+            // Calibrated pulses go to the workspace; the raw ones stay in ws.found.
+            auto findChannelPulses = [&](int iChan) {
+                if (!fe.overThreshold[iChan][lane]) return 0;
+                ws.loadChannel(batch, fe, iChan, lane);
+                FoundPulse *found = ws.found;
+                int nFound = pulseFinder->findPulses(ws, found);
+                num_pulses += nFound;
+                for (int k = 0; k < nFound; k++) {
+                    pulse_temp pt;
+                    pt.start = found[k].startBin * SAMPLE_WIDTH_US; // Convert samples to µs
+                    pt.end = found[k].endBin * SAMPLE_WIDTH_US;
+                    pt.peak = found[k].peak * cal.peakScale[iChan];
+                    pt.energy = found[k].energy * cal.energyScale[iChan];
+                    ws.addPulse(iChan, pt);
+                }
+                return nFound;
+            };
+
+            // PMTs: start times, summed energy and hit mask
+            for (int iChan = PMT_CHANNELS.first; iChan < PMT_CHANNELS.end; iChan++) {
+                int pmt = CHANNEL_LAYOUT[iChan].slot;
+                int nFound = findChannelPulses(iChan);
+                for (int k = 0; k < nFound; k++) {
+                    const pulse_temp &pt = ws.pulses[iChan][k];
+                    ws.timing.add(ws.found[k].startBin, ws.found[k].endBin);
+                    ws.pmtPeak += pt.peak;
+                    ws.pmtEnergy += pt.energy;
+                    ws.pmtHitMask |= static_cast<unsigned short>(pt.energy >= config.pmtHitThreshold[pmt]) << pmt;
                 }
+            }
 
-                // Pulse detection
-                std::vector<pulse_temp> pulses_temp;
-                bool onPulse = false;
-                int thresholdBin = 0, peakBin = 0;
-                double peak = 0, pulseEnergy = 0;
-                double allPulseEnergy = 0;
-
-                for (int iBin = 1; iBin <= ADCSIZE; iBin++) {
-                    double iBinContent = h_wf.GetBinContent(iBin);
-                    if (iBin > 15) allPulseEnergy += iBinContent;
-
-                    if (!onPulse && iBinContent >= PULSE_THRESHOLD) {
-                        onPulse = true;
-                        thresholdBin = iBin;
-                        peakBin = iBin;
-                        peak = iBinContent;
-                        pulseEnergy = iBinContent;
-                    } else if (onPulse) {
-                        pulseEnergy += iBinContent;
-                        if (peak < iBinContent) {
-                            peak = iBinContent;
-                            peakBin = iBin;
-                        }
-                        if (iBinContent < BS_UNCERTAINTY || iBin == ADCSIZE) {
-                            pulse_temp pt;
-                            pt.start = thresholdBin * 16.0 / 1000.0; // Convert ns to µs
-                            pt.peak = iChan <= 11 && mu1[iChan] > 0 ? peak / mu1[iChan] : peak;
-                            pt.end = iBin * 16.0 / 1000.0;
-                            for (int j = peakBin - 1; j >= 1 && h_wf.GetBinContent(j) > BS_UNCERTAINTY; j--) {
-                                if (h_wf.GetBinContent(j) > peak * 0.1) {
-                                    pt.start = j * 16.0 / 1000.0;
-                                }
-                                pulseEnergy += h_wf.GetBinContent(j);
-                            }
-                            if (iChan <= 11) {
-                                pt.energy = mu1[iChan] > 0 ? pulseEnergy / mu1[iChan] : 0;
-                                all_chan_start.push_back(pt.start);
-                                all_chan_end.push_back(pt.end);
-                                all_chan_peak.push_back(pt.peak);
-                                all_chan_energy.push_back(pt.energy);
-                                if (pt.energy > 1) p.number += 1;
-                            }
-                            pulses_temp.push_back(pt);
-                            peak = 0;
-                            peakBin = 0;
-                            pulseEnergy = 0;
-                            thresholdBin = 0;
-                            onPulse = false;
+            // Veto panels: window energies (ADC); their pulses only on the full path
+            for (int iChan = SIDE_PANEL_CHANNELS.first; iChan < SIDE_PANEL_CHANNELS.end; iChan++) {
+                const ChannelDescriptor &d = CHANNEL_LAYOUT[iChan];
+                double energy = fe.integral(iChan, lane, d.firstBin, d.lastBin) * d.panelFactor;
+                ws.vetoEnergy[d.slot] = energy;
+                ws.sideVetoEnergy += energy;
+                if (fullPath) findChannelPulses(iChan);
+            }
+            for (int iChan = TOP_PANEL_CHANNELS.first; iChan < TOP_PANEL_CHANNELS.end; iChan++) {
+                const ChannelDescriptor &d = CHANNEL_LAYOUT[iChan];
+                double energy = fe.integral(iChan, lane, d.firstBin, d.lastBin) * d.panelFactor;
+                ws.vetoEnergy[d.slot] = energy;
+                ws.topVetoEnergy += energy;
+                if (fullPath) findChannelPulses(iChan);
+            }
+
+            // Beam channel integral (EV61), compared per selection
+            double beam_integral = 0;
+            for (int iChan = BEAM_CHANNELS.first; iChan < BEAM_CHANNELS.end; iChan++) {
+                const ChannelDescriptor &d = CHANNEL_LAYOUT[iChan];
+                beam_integral = std::max(beam_integral, fe.integral(iChan, lane, d.firstBin, d.lastBin));
+                if (fullPath) findChannelPulses(iChan);
+            }
+
+            // Hot record for the selection, cold attributes on the side
+            TimingSummary timing = ws.timing.summarize();
+            HotEvent ev;
+            ev.startNs = eventStartNs(nsTime, timing.start);
+            ev.energy = static_cast<float>(ws.pmtEnergy);
+            ev.sideVetoEnergy = static_cast<float>(ws.sideVetoEnergy);
+            ev.topVetoEnergy = static_cast<float>(ws.topVetoEnergy);
+            ev.pmtMask = ws.pmtHitMask;
+            ev.vetoMask = 0; // Set by each selection from its own panel thresholds
+            ev.trigger = storedTrigger(triggerBits);
+            ev.flags = timing.single ? EVENT_SINGLE : 0;
+            unsigned int late_mask = fe.channelMask(lane, FLAG_LATE_PULSE);
+            bool pulse_at_end = pmtMultiplicity(late_mask & PMT_CHANNEL_BITS) >= config.latePulseMinPmts;
+
+            // Count heap allocations made by reconstruction, ignoring the warm-up event
+            if (iEnt > firstEntry) reco_allocations += heapAllocations() - allocations_before;
+
+            if (!time_order_checked) {
+                for (Selection &sel : selections) {
+                    // The veto window goes too, even once its muons have expired
+                    if (ev.startNs < sel.muonWindow.lastEventNs()) {
+                        if (sel.muonWindow.size() > 0) {
+                            cout << "Warning: " << inputFileName << " starts before the previous events; not carrying "
+                                 << sel.config->name << " muons over" << endl;
                         }
+                        sel.muonWindow.clear();
+                        sel.liveTime.clearVeto();
                     }
                 }
+                time_order_checked = true;
+            }
 
-                // Store energy for veto panels (ADC)
-                if (iChan >= 12 && iChan <= 19) {
-                    side_vp_energy.push_back(allPulseEnergy);
-                    veto_energies[iChan - 12] = allPulseEnergy;
-                } else if (iChan >= 20 && iChan <= 21) {
-                    double factor = (iChan == 20) ? 1.07809 : 1.0;
-                    top_vp_energy.push_back(allPulseEnergy * factor);
-                    veto_energies[iChan - 12] = allPulseEnergy * factor;
+            // Every selection sees the same reconstructed event with its own cuts
+            EventInputs inputs = {&ws, config.pmtHitThreshold, beam_integral, pulse_at_end, path};
+            for (Selection &sel : selections) {
+                const SelectionConfig &cfg = *sel.config;
+                SelectionResult r = sel.process(sel, ev, inputs);
+                const HotEvent &sev = r.event;
+                if (sev.flags & EVENT_BEAM) sel.beam_events++;
+                sel.liveTime.addEvent(sev.startNs, sev.flags & EVENT_BEAM, r.muon);
+
+                // Keep the primary selection's candidates with the front-end quality masks
+                if (&sel == &selections[0] && (r.muon || r.michel)) {
+                    ColdEvent cold;
+                    cold.end = nsTime / 1000.0 + timing.end;
+                    cold.peak = ws.pmtPeak;
+                    cold.lateMask = late_mask;
+                    cold.saturatedMask = fe.channelMask(lane, FLAG_SATURATED);
+                    cold.clippedMask = fe.channelMask(lane, FLAG_CLIPPED);
+                    cold.eventID = eventID;
+                    candidates.add(sev, cold);
                 }
 
-                // Check for pulses at waveform end
-                if (iChan <= 11 && h_wf.GetBinContent(ADCSIZE) > 100) {
-                    pulse_at_end_count++;
-                    if (pulse_at_end_count >= 10) pulse_at_end = true;
+                // Muon detection
+                if (r.muon) {
+                    sel.num_muons++;
+                    sel.h_side_vp_muon->Fill(sev.sideVetoEnergy);
+                    sel.h_top_vp_muon->Fill(sev.topVetoEnergy);
                 }
 
-                h_wf.Reset();
-            }
+                // Apply additional cut for dt plots; energy_vs_dt follows the selection's fill rule
+                bool is_michel_for_dt = r.michel && sev.energy <= cfg.michelEnergyMaxDt;
+                bool fill_energy_vs_dt = sel.energyVsDtFill == ENERGY_VS_DT_DT ? is_michel_for_dt
+                                                                                : sel.energyVsDtFill == ENERGY_VS_DT_MICHEL && r.michel;
+                bool every_event = sel.energyVsDtFill == ENERGY_VS_DT_ALL;
+                AnalysisHistograms *split = (r.michel || every_event) && splitCategories ? &sel.category(sev) : nullptr;
+
+                if (r.michel) {
+                    sel.num_michels++;
+                    if (r.nParents > 1) sel.multi_parent_michels++;
+                    // Parent muon energy, once per muon however many Michels follow it
+                    if (!r.parent->tagged) {
+                        r.parent->tagged = true;
+                        sel.tagged_muons++;
+                        sel.h_muon_energy->Fill(r.parent->energy);
+                        if (split) split->h_muon_energy->Fill(r.parent->energy);
+                    }
+                    // Fill Michel energy histogram with original criteria
+                    sel.h_michel_energy->Fill(sev.energy);
+                    if (split) split->h_michel_energy->Fill(sev.energy);
+                    sel.h_pmt_multiplicity->Fill(r.multiplicity);
+                    for (unsigned int hits = sev.pmtMask; hits; hits &= hits - 1) {
+                        sel.h_pmt_hit_pattern->Fill(__builtin_ctz(hits) + 1);
+                    }
+                }
 
-            // Aggregate pulse properties
-            p.start += mostFrequent(all_chan_start);
-            p.end += mostFrequent(all_chan_end);
-            p.energy = std::accumulate(all_chan_energy.begin(), all_chan_energy.end(), 0.0);
-            p.peak = std::accumulate(all_chan_peak.begin(), all_chan_peak.end(), 0.0);
-            p.side_vp_energy = std::accumulate(side_vp_energy.begin(), side_vp_energy.end(), 0.0);
-            p.top_vp_energy = std::accumulate(top_vp_energy.begin(), top_vp_energy.end(), 0.0);
-            p.all_vp_energy = p.side_vp_energy + p.top_vp_energy;
-
-            // Check timing consistency
-            for (const auto& start : all_chan_start) {
-                if (fabs(start - mostFrequent(all_chan_start)) < 10 * 16.0 / 1000.0) {
-                    chan_starts_no_outliers.push_back(start);
+                if (is_michel_for_dt || fill_energy_vs_dt) {
+                    // Fill dt with the stricter energy cut, energy_vs_dt by the fill rule
+                    auto fillPair = [&](double dt) {
+                        if (is_michel_for_dt) {
+                            sel.h_dt_michel->Fill(dt);
+                            if (split) split->h_dt_michel->Fill(dt);
+                        }
+                        if (fill_energy_vs_dt) {
+                            sel.h_energy_vs_dt->Fill(dt, sev.energy);
+                            if (split) split->h_energy_vs_dt->Fill(dt, sev.energy);
+                        }
+                    };
+                    if (allMichelPairs) {
+                        sel.muonWindow.forEachParent(sev.startNs, sel.dtMinNs, sel.dtMaxNs,
+                                                     [&](const MuonEntry &, long long dtNs) { fillPair(dtNs / 1000.0); });
+                    } else {
+                        fillPair((sev.startNs - r.parent->startNs) / 1000.0); // µs
+                    }
                 }
-            }
-            p.single = (variance(chan_starts_no_outliers) < 5 * 16.0 / 1000.0);
-
-            // Muon detection
-            bool veto_hit = false;
-            for (size_t i = 0; i < SIDE_VP_THRESHOLDS.size(); i++) {
-                if (veto_energies[i] > SIDE_VP_THRESHOLDS[i]) {
-                    veto_hit = true;
-                    break;
+                if (every_event && sel.muonWindow.size() > 0) {
+                    // Before any Michel cut, like the variants that fill it for every event; a muon is at dt 0
+                    double dt = (sev.startNs - sel.muonWindow.at(0).startNs) / 1000.0;
+                    sel.h_energy_vs_dt->Fill(dt, sev.energy);
+                    if (split) split->h_energy_vs_dt->Fill(dt, sev.energy);
                 }
-            }
-            if (!veto_hit && p.top_vp_energy > TOP_VP_THRESHOLD) veto_hit = true;
-
-            if ((p.energy > MUON_ENERGY_THRESHOLD && veto_hit) ||
-                (pulse_at_end && p.energy > MUON_ENERGY_THRESHOLD / 2 && veto_hit)) {
-                p.is_muon = true;
-                last_muon_time = p.start;
-                num_muons++;
-                muon_candidates.emplace_back(p.start, p.energy);
-                h_side_vp_muon->Fill(p.side_vp_energy);
-                h_top_vp_muon->Fill(p.top_vp_energy);
-            }
 
-            // Michel electron detection
-            double dt = p.start - last_muon_time;
-            bool veto_low = true;
-            for (size_t i = 0; i < SIDE_VP_THRESHOLDS.size(); i++) {
-                if (veto_energies[i] > SIDE_VP_THRESHOLDS[i]) {
-                    veto_low = false;
-                    break;
+                // Delayed windows, from the same muons; dt like the Michel plots
+                for (unsigned passed = r.delayedMask; passed; passed &= passed - 1) {
+                    int w = __builtin_ctz(passed);
+                    const DelayedWindow &window = sel.windows[w];
+                    WindowHistograms &h = sel.windowHistograms[w];
+                    h.candidates++;
+                    h.h_delayed_energy->Fill(sev.energy);
+                    h.h_delayed_multiplicity->Fill(r.multiplicity);
+                    if (allMichelPairs) {
+                        sel.muonWindow.forEachParent(sev.startNs, window.dtMinNs, window.dtMaxNs,
+                                                     [&](const MuonEntry &, long long dtNs) {
+                                                         h.h_delayed_dt->Fill(dtNs / 1000.0);
+                                                     });
+                    } else {
+                        h.h_delayed_dt->Fill((sev.startNs - r.delayedParent[w]->startNs) / 1000.0);
+                    }
                 }
             }
-            if (veto_energies[8] > TOP_VP_THRESHOLD || veto_energies[9] > TOP_VP_THRESHOLD) {
-                veto_low = false;
-            }
+        }
 
-            // Define common Michel electron criteria
-            bool is_michel_candidate = p.energy >= MICHEL_ENERGY_MIN &&
-                                      p.energy <= MICHEL_ENERGY_MAX &&
-                                      dt >= MICHEL_DT_MIN &&
-                                      dt <= MICHEL_DT_MAX &&
-                                      p.number >= 8 &&
-                                      veto_low &&
-                                      p.trigger != 1 &&
-                                      p.trigger != 4 &&
-                                      p.trigger != 8 &&
-                                      p.trigger != 16;
-
-            // Apply additional cut for dt and energy_vs_dt plots
-            bool is_michel_for_dt = is_michel_candidate && p.energy <= MICHEL_ENERGY_MAX_DT;
-
-            if (is_michel_candidate) {
-                p.is_michel = true;
-                num_michels++;
-                michel_muon_times.insert(last_muon_time);
-                // Fill Michel energy histogram with original criteria
-                h_michel_energy->Fill(p.energy);
+        // Print stats to console
+        cout << "File " << inputFileName << " Statistics:\n";
+        cout << "Total Events: " << num_events << "\n";
+        for (Selection &sel : selections) {
+            if (selections.size() > 1) cout << "Selection " << sel.config->name << ":\n";
+            cout << "Muons Detected: " << sel.num_muons << "\n";
+            cout << "Michel Electrons Detected: " << sel.num_michels << "\n";
+            cout << "Muons followed by a Michel: " << sel.tagged_muons << "\n";
+            cout << "Michels with more than one candidate parent muon: " << sel.multi_parent_michels << "\n";
+            cout << "Beam-on events: " << sel.beam_events << "\n";
+            LiveTimeCounts live = sel.liveTime.endRun();
+            cout << "Live time: " << (live.totalSpanNs() - live.totalDeadNs()) * 1e-9 << " s of " << live.totalSpanNs() * 1e-9
+                 << " s (beam on " << live.liveNs(1) * 1e-9 << " of " << live.spanNs[1] * 1e-9 << " s, beam off "
+                 << live.liveNs(0) * 1e-9 << " of " << live.spanNs[0] * 1e-9 << " s; " << live.muons
+                 << " muon vetoes of " << sel.config->muonDeadTime << " µs)\n";
+            sel.muonCuts.print(cout, "Muon");
+            sel.michelCuts.print(cout, "Michel");
+            for (size_t w = 0; w < sel.windows.size(); w++) {
+                const DelayedWindowConfig &window = *sel.windows[w].config;
+                cout << "Delayed " << window.name << " candidates (" << window.dtMin << "-" << window.dtMax
+                     << " µs): " << sel.windowHistograms[w].candidates << "\n";
+                sel.windows[w].cuts.print(cout, "Delayed " + window.name);
             }
-
-            if (is_michel_for_dt) {
-                // Fill dt and energy_vs_dt histograms with stricter energy cut
-                h_dt_michel->Fill(dt);
-                h_energy_vs_dt->Fill(dt, p.energy);
+            if (sel.muonWindow.overflows() > 0) {
+                cout << "Warning: " << sel.muonWindow.overflows() << " muons dropped from a full coincidence window\n";
             }
-
-            p.last_muon_time = last_muon_time;
+            sel.resetCounters();
         }
-
-        // Second pass: Fill h_muon_energy for muons associated with Michel electrons
-        for (const auto& muon : muon_candidates) {
-            if (michel_muon_times.find(muon.first) != michel_muon_times.end()) {
-                h_muon_energy->Fill(muon.second);
+        if (validateFixedPoint) {
+            cout << "Max fixed-point prefix-sum deviation from double: " << max_fixed_deviation << " ADC\n";
+            cout << "Fixed-point pulses vs double: " << fixed_comparison.countMismatches << " of " << fixed_comparison.channels
+                 << " channels with a different pulse count; " << fixed_comparison.startMismatches << " of "
+                 << fixed_comparison.pulses << " pulses start on another sample (max " << fixed_comparison.maxStartDeviation
+                 << "); max pulse energy deviation " << fixed_comparison.maxEnergyDeviation << " ADC\n";
+        }
+        long saturated_candidates = 0, clipped_candidates = 0;
+        for (const ColdEvent &cold : candidates.cold) {
+            saturated_candidates += (cold.saturatedMask & PMT_CHANNEL_BITS) != 0;
+            clipped_candidates += (cold.clippedMask & PMT_CHANNEL_BITS) != 0;
+        }
+        cout << "Candidates with a saturated PMT: " << saturated_candidates << ", with a clipped PMT pulse: "
+             << clipped_candidates << " of " << candidates.size() << "\n";
+        candidateTree.flush(candidates);
+        cout << "Events by trigger path: full " << path_counts[PATH_FULL] << ", muon-only " << path_counts[PATH_MUON_ONLY]
+             << ", calibration " << path_counts[PATH_CALIBRATION] << "\n";
+        if (path_counts[PATH_CALIBRATION] > 0) {
+            cout << "Mean LED charge per PMT (p.e.):";
+            for (int iPMT = 0; iPMT < N_PMTS; iPMT++) cout << " " << led_charge[iPMT] / path_counts[PATH_CALIBRATION];
+            cout << "\n";
+        }
+        double events_in_run = num_events > 0 ? num_events : 1;
+        cout << "Pulses per event: " << num_pulses / events_in_run << " found; threshold finder at the flat threshold "
+             << flat_pulses / events_in_run << ", at the applied thresholds " << applied_pulses / events_in_run << "\n";
+        if (noiseThresholds) {
+            cout << "Raised pulse thresholds (channel: ADC):";
+            for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+                if (raised_thresholds & (1u << iChan)) cout << " " << iChan << ": " << runSettings.pulseThreshold[iChan];
             }
+            cout << (raised_thresholds ? "\n" : " none\n");
+        }
+        if (trackBaseline) {
+            cout << "Stored baselines overridden (channel: events):";
+            for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+                if (baselineTracker.disagreements(iChan) > 0) {
+                    cout << " " << iChan << ": " << baselineTracker.disagreements(iChan);
+                }
+            }
+            cout << " of " << baselineTracker.events() << " events\n";
+        }
+        if (heapAllocationsCounted()) {
+            cout << "Heap allocations in reconstruction (after first event): " << reco_allocations << "\n";
+        } else {
+            cout << "Heap allocations in reconstruction: not counted (build with -DCOUNT_EVENT_ALLOCATIONS)\n";
         }
-
-        // Print stats to console
-        cout << "File " << inputFileName << " Statistics:\n";
-        cout << "Total Events: " << num_events << "\n";
-        cout << "Muons Detected: " << num_muons << "\n";
-        cout << "Michel Electrons Detected: " << num_michels << "\n";
         cout << "------------------------\n";
 
         f->Close();
 
         num_events = 0;
-        num_muons = 0;
-        num_michels = 0;
+    }
+
+    if (!stateOut.empty()) {
+        for (size_t iSel = 0; iSel < selections.size(); iSel++) {
+            const MuonWindow &muonWindow = selections[iSel].muonWindow;
+            string stateFile = selectionStateFile(stateOut, selections[iSel]);
+            CorrelatorState state = muonWindow.saveState();
+            state.runLastNs = selections[iSel].liveTime.previousNs();
+            state.runLastBeam = selections[iSel].liveTime.previousBeam();
+            state.configHash = configHashValue;
+            if (!writeCorrelatorState(stateFile, state)) {
+                cerr << "Error writing correlator state: " << stateFile << endl;
+            } else {
+                cout << "Saved correlator state (" << muonWindow.size() << " muons) to " << stateFile << endl;
+            }
+        }
     }
 
     // Print triggerBits distribution
@@ -582,7 +1281,18 @@ int main(int argc, char *argv[]) {
     }
     cout << "------------------------\n";
 
-    // Generate analysis plots
+    // Generate analysis plots for the primary selection
+    const double fitMin = config.fitMin;
+    const double fitMax = config.fitMax;
+    const Selection &primary = selections[0];
+    TH1D *h_muon_energy = primary.h_muon_energy;
+    TH1D *h_michel_energy = primary.h_michel_energy;
+    TH1D *h_dt_michel = primary.h_dt_michel;
+    TH2D *h_energy_vs_dt = primary.h_energy_vs_dt;
+    TH1D *h_side_vp_muon = primary.h_side_vp_muon;
+    TH1D *h_top_vp_muon = primary.h_top_vp_muon;
+    TH1D *h_pmt_multiplicity = primary.h_pmt_multiplicity;
+    TH1D *h_pmt_hit_pattern = primary.h_pmt_hit_pattern;
     TCanvas *c = new TCanvas("c", "Analysis Plots", 1200, 800);
     gStyle->SetOptStat(1111);
     gStyle->SetOptFit(1111);
@@ -613,9 +1323,9 @@ int main(int argc, char *argv[]) {
     h_dt_michel->Draw("PE");
 
     if (h_dt_michel->GetEntries() > 5) {
-        double integral = h_dt_michel->Integral(h_dt_michel->FindBin(FIT_MIN), h_dt_michel->FindBin(FIT_MAX));
+        double integral = h_dt_michel->Integral(h_dt_michel->FindBin(fitMin), h_dt_michel->FindBin(fitMax));
         double bin_width = h_dt_michel->GetBinWidth(1);
-        double N0_init = integral * bin_width / (FIT_MAX - FIT_MIN);
+        double N0_init = integral * bin_width / (fitMax - fitMin);
         double C_init = 0;
         int bin_14 = h_dt_michel->FindBin(14.0);
         int bin_16 = h_dt_michel->FindBin(16.0);
@@ -627,7 +1337,7 @@ int main(int argc, char *argv[]) {
         if (min_content < 1e9) C_init = min_content;
         else C_init = 0.1;
 
-        TF1 *expFit = new TF1("expFit", ExpFit, FIT_MIN, FIT_MAX, 3);
+        TF1 *expFit = new TF1("expFit", ExpFit, fitMin, fitMax, 3);
         expFit->SetParameters(N0_init, 2.2, C_init);
         expFit->SetParLimits(0, 0, N0_init * 100);
         expFit->SetParLimits(1, 0.1, 20.0);
@@ -635,7 +1345,7 @@ int main(int argc, char *argv[]) {
         expFit->SetParNames("N_{0}", "#tau", "C");
         expFit->SetNpx(1000);
 
-        int fitStatus = h_dt_michel->Fit(expFit, "RE", "", FIT_MIN, FIT_MAX);
+        int fitStatus = h_dt_michel->Fit(expFit, "RE", "", fitMin, fitMax);
         expFit->SetLineColor(kGreen);
         expFit->SetLineWidth(3);
         expFit->Draw("same");
@@ -693,7 +1403,7 @@ int main(int argc, char *argv[]) {
         delete expFit;
     } else {
         cout << "Warning: h_dt_michel has insufficient entries (" << h_dt_michel->GetEntries() << "), skipping exponential fit" << endl;
-        cout << "Check Michel electron detection criteria (e.g., MICHEL_ENERGY_MIN, p.number, veto thresholds)." << endl;
+        cout << "Check the Michel cut flow above and the Michel criteria (MICHEL_CUTS, veto thresholds)." << endl;
     }
 
     c->Update();
@@ -703,6 +1413,10 @@ int main(int argc, char *argv[]) {
     c->SaveAs(plotName.c_str());
     cout << "Saved plot: " << plotName << endl;
 
+    // Optional comparison of fit start times (fit_scan_starts)
+    if (!config.fitScanStarts.empty()) scanFitStart(h_dt_michel, config.fitScanStarts, config.fitScanEnd);
+    c->cd();
+
     // Energy vs dt
     c->Clear();
     h_energy_vs_dt->SetStats(0);
@@ -740,16 +1454,44 @@ int main(int argc, char *argv[]) {
     c->SaveAs(plotName.c_str());
     cout << "Saved plot: " << plotName << endl;
 
+    // PMT Multiplicity
+    c->Clear();
+    h_pmt_multiplicity->SetLineColor(kBlue);
+    h_pmt_multiplicity->Draw();
+    c->Update();
+    plotName = OUTPUT_DIR + "/PMT_Multiplicity.png";
+    c->SaveAs(plotName.c_str());
+    cout << "Saved plot: " << plotName << endl;
+
+    // PMT Hit Pattern
+    c->Clear();
+    h_pmt_hit_pattern->SetLineColor(kBlue);
+    h_pmt_hit_pattern->Draw();
+    c->Update();
+    plotName = OUTPUT_DIR + "/PMT_Hit_Pattern.png";
+    c->SaveAs(plotName.c_str());
+    cout << "Saved plot: " << plotName << endl;
+
+    // Save the histograms so jobs over separate chunks can be merged with hadd
+    histFile->cd();
+    for (Selection &sel : selections) {
+        sel.fillLiveTime();
+        sel.writeHistograms();
+    }
+    h_trigger_bits->Write();
+    candidateTree.tree->Write();
+    TNamed("config_hash", configHashText.c_str()).Write();
+    TNamed("config", configText.c_str()).Write();
+    histFile->Close();
+    cout << "Saved histograms: " << histFileName << endl;
+    delete histFile;
+
     // Clean up
-    delete h_muon_energy;
-    delete h_michel_energy;
-    delete h_dt_michel;
-    delete h_energy_vs_dt;
-    delete h_side_vp_muon;
-    delete h_top_vp_muon;
+    for (Selection &sel : selections) sel.deleteHistograms();
     delete h_trigger_bits;
     delete c;
+    delete pulseFinder;
 
-    cout << "Analysis complete. Results saved in " << OUTPUT_DIR << "/ (*.png)" << endl;
+    cout << "Analysis complete. Results saved in " << OUTPUT_DIR << "/ (*.png, histograms.root)" << endl;
     return 0;
 }
@@ -0,0 +1,211 @@
+#ifndef MUON_CORRELATOR_H
+#define MUON_CORRELATOR_H
+
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Muon tagged for delayed-coincidence searches
+struct MuonEntry {
+    long long startNs;       // Muon time (ns)
+    float energy;            // Summed PMT energy (p.e.)
+    unsigned short vetoMask; // Veto panels over threshold (see vetoHitMask)
+    int id;                  // Muon number, counted across runs and chunks
+    bool tagged;             // A Michel has already been assigned to this muon
+};
+
+const int MUON_WINDOW_CAPACITY = 16; // Muons held at once; a power of two
+static_assert((MUON_WINDOW_CAPACITY & (MUON_WINDOW_CAPACITY - 1)) == 0, "Ring index wraps with a mask");
+
+// Everything the correlator carries from one run or chunk into the next.
+// Restoring it before the next events makes the tagging identical to
+// processing both parts in one job.
+struct CorrelatorState {
+    MuonEntry muons[MUON_WINDOW_CAPACITY]; // Muons still in the window, oldest first
+    int nMuons;                            // Entries used in muons[]
+    int nextMuonId;                        // Id for the next muon
+    long overflows;                        // Muons pushed out before expiring
+    long long lastEventNs;                 // Latest event time seen (ns)
+    long long runLastNs;                   // Latest event of the open live-time run (ns), LLONG_MIN if none
+    int runLastBeam;                       // Beam state of that event
+    uint64_t configHash;                   // Analysis configuration the muons were selected with
+};
+
+// Recent muons in time order, in a fixed ring buffer. Events arrive in
+// time order, so muons older than the longest window can be dropped from
+// the tail as each event is processed: expiry is amortized O(1) and the
+// scan for parents only walks muons that are still in the window.
+class MuonWindow {
+public:
+    explicit MuonWindow(long long maxDtNs) : maxDtNs_(maxDtNs) { reset(); }
+
+    // Keep muons for at least maxDtNs; call before the first event
+    void extend(long long maxDtNs) {
+        if (maxDtNs > maxDtNs_) maxDtNs_ = maxDtNs;
+    }
+
+    // Drop the muons but keep ids and counters, e.g. when time goes backwards
+    void clear() { count_ = 0; }
+
+    void reset() {
+        head_ = 0;
+        count_ = 0;
+        nextId_ = 0;
+        overflows_ = 0;
+        lastEventNs_ = LLONG_MIN;
+    }
+
+    // Drop muons more than the window length before nowNs; call once per event
+    void expire(long long nowNs) {
+        while (count_ > 0 && nowNs - at(count_ - 1).startNs > maxDtNs_) count_--;
+        if (nowNs > lastEventNs_) lastEventNs_ = nowNs;
+    }
+
+    // Add the newest muon and return its id; the oldest is overwritten if the buffer is full
+    int push(long long startNs, float energy, unsigned short vetoMask) {
+        head_ = (head_ + 1) & (MUON_WINDOW_CAPACITY - 1);
+        buffer_[head_] = {startNs, energy, vetoMask, nextId_, false};
+        if (count_ < MUON_WINDOW_CAPACITY) {
+            count_++;
+        } else {
+            overflows_++;
+        }
+        return nextId_++;
+    }
+
+    CorrelatorState saveState() const {
+        CorrelatorState state;
+        state.nMuons = count_;
+        for (int i = 0; i < count_; i++) state.muons[i] = at(count_ - 1 - i);
+        state.nextMuonId = nextId_;
+        state.overflows = overflows_;
+        state.lastEventNs = lastEventNs_;
+        state.runLastNs = LLONG_MIN;
+        state.runLastBeam = 0;
+        state.configHash = 0;
+        return state;
+    }
+
+    void restoreState(const CorrelatorState &state) {
+        reset();
+        for (int i = 0; i < state.nMuons; i++) {
+            head_ = (head_ + 1) & (MUON_WINDOW_CAPACITY - 1);
+            buffer_[head_] = state.muons[i];
+        }
+        count_ = state.nMuons;
+        nextId_ = state.nextMuonId;
+        overflows_ = state.overflows;
+        lastEventNs_ = state.lastEventNs;
+    }
+
+    // Call f(muon, dtNs) for every muon with minDtNs <= dt <= maxDtNs before
+    // nowNs, newest first. Returns the number of such muons.
+    template <class F>
+    int forEachParent(long long nowNs, long long minDtNs, long long maxDtNs, F f) {
+        int n = 0;
+        for (int i = 0; i < count_; i++) {
+            MuonEntry &muon = at(i);
+            long long dt = nowNs - muon.startNs;
+            if (dt > maxDtNs) break;
+            if (dt < minDtNs) continue;
+            f(muon, dt);
+            n++;
+        }
+        return n;
+    }
+
+    int size() const { return count_; }
+    long overflows() const { return overflows_; }
+    long long lastEventNs() const { return lastEventNs_; }
+
+    // i-th newest muon, 0 = most recent
+    const MuonEntry &at(int i) const { return buffer_[(head_ - i) & (MUON_WINDOW_CAPACITY - 1)]; }
+    MuonEntry &at(int i) { return buffer_[(head_ - i) & (MUON_WINDOW_CAPACITY - 1)]; }
+
+private:
+    MuonEntry buffer_[MUON_WINDOW_CAPACITY];
+    long long maxDtNs_; // Longest delay any search needs (ns)
+    int head_;          // Slot of the newest muon
+    int count_;         // Muons in the window
+    int nextId_;        // Id for the next muon
+    long overflows_;    // Muons pushed out before expiring
+    long long lastEventNs_; // Latest event time seen (ns)
+};
+
+// Correlator state file: magic, version, then the fields as fixed-width
+// integers in host byte order. Written by one job, read by the next on the
+// same kind of machine.
+const uint32_t CORRELATOR_STATE_MAGIC = 0x4E4F554D; // "MUON"
+const uint32_t CORRELATOR_STATE_VERSION = 3;        // 2: configuration hash after the header; 3: live-time run
+
+inline bool writeCorrelatorState(const std::string &path, const CorrelatorState &state) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) return false;
+    uint32_t header[2] = {CORRELATOR_STATE_MAGIC, CORRELATOR_STATE_VERSION};
+    int64_t counters[3] = {state.nMuons, state.nextMuonId, state.overflows};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&state.configHash), sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(counters), sizeof(counters));
+    out.write(reinterpret_cast<const char *>(&state.lastEventNs), sizeof(int64_t));
+    int64_t runLastNs = state.runLastNs;
+    uint8_t runLastBeam = state.runLastBeam;
+    out.write(reinterpret_cast<const char *>(&runLastNs), sizeof(runLastNs));
+    out.write(reinterpret_cast<const char *>(&runLastBeam), sizeof(runLastBeam));
+    for (int i = 0; i < state.nMuons; i++) {
+        const MuonEntry &muon = state.muons[i];
+        int64_t startNs = muon.startNs;
+        int32_t id = muon.id;
+        uint16_t vetoMask = muon.vetoMask;
+        uint8_t tagged = muon.tagged;
+        out.write(reinterpret_cast<const char *>(&startNs), sizeof(startNs));
+        out.write(reinterpret_cast<const char *>(&muon.energy), sizeof(float));
+        out.write(reinterpret_cast<const char *>(&id), sizeof(id));
+        out.write(reinterpret_cast<const char *>(&vetoMask), sizeof(vetoMask));
+        out.write(reinterpret_cast<const char *>(&tagged), sizeof(tagged));
+    }
+    return static_cast<bool>(out);
+}
+
+inline bool readCorrelatorState(const std::string &path, CorrelatorState &state) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    uint32_t header[2];
+    int64_t counters[3];
+    int64_t lastEventNs;
+    int64_t runLastNs;
+    uint8_t runLastBeam;
+    in.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!in || header[0] != CORRELATOR_STATE_MAGIC || header[1] != CORRELATOR_STATE_VERSION) return false;
+    in.read(reinterpret_cast<char *>(&state.configHash), sizeof(uint64_t));
+    in.read(reinterpret_cast<char *>(counters), sizeof(counters));
+    in.read(reinterpret_cast<char *>(&lastEventNs), sizeof(lastEventNs));
+    in.read(reinterpret_cast<char *>(&runLastNs), sizeof(runLastNs));
+    in.read(reinterpret_cast<char *>(&runLastBeam), sizeof(runLastBeam));
+    if (!in || counters[0] < 0 || counters[0] > MUON_WINDOW_CAPACITY) return false;
+    state.nMuons = static_cast<int>(counters[0]);
+    state.nextMuonId = static_cast<int>(counters[1]);
+    state.overflows = static_cast<long>(counters[2]);
+    state.lastEventNs = lastEventNs;
+    state.runLastNs = runLastNs;
+    state.runLastBeam = runLastBeam != 0;
+    for (int i = 0; i < state.nMuons; i++) {
+        MuonEntry &muon = state.muons[i];
+        int64_t startNs;
+        int32_t id;
+        uint16_t vetoMask;
+        uint8_t tagged;
+        in.read(reinterpret_cast<char *>(&startNs), sizeof(startNs));
+        in.read(reinterpret_cast<char *>(&muon.energy), sizeof(float));
+        in.read(reinterpret_cast<char *>(&id), sizeof(id));
+        in.read(reinterpret_cast<char *>(&vetoMask), sizeof(vetoMask));
+        in.read(reinterpret_cast<char *>(&tagged), sizeof(tagged));
+        muon.startNs = startNs;
+        muon.id = id;
+        muon.vetoMask = vetoMask;
+        muon.tagged = tagged != 0;
+    }
+    return static_cast<bool>(in);
+}
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef PULSE_FINDER_H
+#define PULSE_FINDER_H
+
+#include "EventKernel.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Pulse-finding algorithm for one channel of one event.
+// Implementations read the waveform, prefix sums, noise mask and the
+// channel's pulse threshold that EventWorkspace::loadChannel() put in the
+// workspace. After the fixed-point front end the waveform is int32 samples
+// in ws.fixedWf, and the threshold and peak tests run on those directly.
+class PulseFinder {
+public:
+    virtual ~PulseFinder() {}
+    virtual const char *name() const = 0;
+    // Fill out[] (capacity MAX_PULSES_PER_CHANNEL) and return the number of pulses
+    virtual int findPulses(const EventWorkspace &ws, FoundPulse *out) const = 0;
+};
+
+// A tenth of a pulse peak, for the onset test sample > tenthOf(peak). For
+// integer samples and a positive peak, truncation gives the same answer as
+// the exact tenth.
+inline double tenthOf(double peak) { return peak * 0.1; }
+inline int tenthOf(int peak) { return peak / 10; }
+
+// Reference algorithm: arm at the pulse threshold, close below the baseline
+// uncertainty, start at the earliest sample over 10% of the peak in the run
+// before the peak. The charge includes that pre-peak run a second time, as
+// the original walk-back did, so calibrated thresholds keep their meaning.
+class ThresholdPulseFinder : public PulseFinder {
+public:
+    explicit ThresholdPulseFinder(double baselineUncertainty)
+        : baselineUncertainty(baselineUncertainty), closeFixed(fixedPointCeil(baselineUncertainty)) {}
+
+    const char *name() const { return "threshold"; }
+
+    int findPulses(const EventWorkspace &ws, FoundPulse *out) const {
+        if (ws.fixedPoint) return scan(ws, ws.fixedWf, ws.fixedThreshold, closeFixed, FIXED_POINT_UNIT, out);
+        return scan(ws, ws.wf, ws.threshold, baselineUncertainty, 1.0, out);
+    }
+
+private:
+    // Samples and levels in one unit (ADC or 1/256 ADC); unit converts peaks to ADC
+    template <class Sample>
+    int scan(const EventWorkspace &ws, const Sample *wf, Sample threshold, Sample close, double unit, FoundPulse *out) const {
+        int n = 0;
+        bool onPulse = false;
+        int thresholdBin = 0, peakBin = 0;
+        Sample peak = 0;
+        for (int iBin = 1; iBin <= ADCSIZE; iBin++) {
+            Sample iBinContent = wf[iBin];
+            if (!onPulse && iBinContent >= threshold) {
+                onPulse = true;
+                thresholdBin = iBin;
+                peakBin = iBin;
+                peak = iBinContent;
+            } else if (onPulse) {
+                if (peak < iBinContent) {
+                    peak = iBinContent;
+                    peakBin = iBin;
+                }
+                if (iBinContent < close || iBin == ADCSIZE) {
+                    FoundPulse &fp = out[n++];
+                    int leadBin = ws.leadingEdgeBin(peakBin);
+                    fp.startBin = thresholdBin;
+                    for (int j = leadBin; j < peakBin; j++) {
+                        if (wf[j] > tenthOf(peak)) {
+                            fp.startBin = j;
+                            break;
+                        }
+                    }
+                    fp.endBin = iBin;
+                    fp.peakBin = peakBin;
+                    fp.peak = peak * unit;
+                    fp.energy = ws.integral(thresholdBin, iBin) + ws.integral(leadBin, peakBin - 1);
+                    onPulse = false;
+                    if (n == MAX_PULSES_PER_CHANNEL) break;
+                }
+            }
+        }
+        return n;
+    }
+
+    double baselineUncertainty; // Pulse closes below this (ADC)
+    int closeFixed;             // Same in fixed point
+};
+
+// Digital constant-fraction discriminator. Pulses are armed and closed like
+// the reference; the start is the zero crossing of fraction*x[i] - x[i-delay]
+// on the leading edge, shifted back by the delay and rounded to a sample.
+// The charge is the plain integral from start to end.
+class CfdPulseFinder : public PulseFinder {
+public:
+    explicit CfdPulseFinder(double baselineUncertainty, double fraction = 0.3, int delay = 2)
+        : baselineUncertainty(baselineUncertainty), closeFixed(fixedPointCeil(baselineUncertainty)),
+          fraction(fraction), delay(delay) {}
+
+    const char *name() const { return "cfd"; }
+
+    int findPulses(const EventWorkspace &ws, FoundPulse *out) const {
+        if (ws.fixedPoint) return scan(ws, ws.fixedWf, ws.fixedThreshold, closeFixed, FIXED_POINT_UNIT, out);
+        return scan(ws, ws.wf, ws.threshold, baselineUncertainty, 1.0, out);
+    }
+
+private:
+    template <class Sample>
+    int scan(const EventWorkspace &ws, const Sample *wf, Sample threshold, Sample close, double unit, FoundPulse *out) const {
+        int n = 0;
+        bool onPulse = false;
+        int thresholdBin = 0, peakBin = 0;
+        Sample peak = 0;
+        for (int iBin = 1; iBin <= ADCSIZE; iBin++) {
+            Sample iBinContent = wf[iBin];
+            if (!onPulse && iBinContent >= threshold) {
+                onPulse = true;
+                thresholdBin = iBin;
+                peakBin = iBin;
+                peak = iBinContent;
+            } else if (onPulse) {
+                if (peak < iBinContent) {
+                    peak = iBinContent;
+                    peakBin = iBin;
+                }
+                if (iBinContent < close || iBin == ADCSIZE) {
+                    FoundPulse &fp = out[n++];
+                    fp.startBin = crossingBin(wf, ws.leadingEdgeBin(peakBin), peakBin, thresholdBin);
+                    fp.endBin = iBin;
+                    fp.peakBin = peakBin;
+                    fp.peak = peak * unit;
+                    fp.energy = ws.integral(fp.startBin, iBin);
+                    onPulse = false;
+                    if (n == MAX_PULSES_PER_CHANNEL) break;
+                }
+            }
+        }
+        return n;
+    }
+
+    template <class Sample>
+    double sample(const Sample *wf, int iBin) const { return iBin >= 1 ? wf[iBin] : 0.0; }
+
+    // Positive-to-negative zero crossing of the CFD signal between leadBin and
+    // the peak; the crossing does not depend on the sample unit
+    template <class Sample>
+    int crossingBin(const Sample *wf, int leadBin, int peakBin, int fallback) const {
+        double prev = fraction * sample(wf, leadBin) - sample(wf, leadBin - delay);
+        for (int j = leadBin + 1; j <= peakBin + delay && j <= ADCSIZE; j++) {
+            double cur = fraction * wf[j] - sample(wf, j - delay);
+            if (prev > 0 && cur <= 0) {
+                double t = j - 1 + prev / (prev - cur) - delay;
+                int bin = static_cast<int>(std::floor(t + 0.5));
+                if (bin < leadBin) bin = leadBin;
+                if (bin > peakBin) bin = peakBin;
+                return bin;
+            }
+            prev = cur;
+        }
+        return fallback < leadBin ? fallback : leadBin;
+    }
+
+    double baselineUncertainty; // Pulse closes below this (ADC)
+    int closeFixed;             // Same in fixed point
+    double fraction;            // CFD attenuation
+    int delay;                  // CFD delay (samples)
+};
+
+// Digital matched filter. The waveform is correlated with a unit-height PMT
+// pulse template, normalized so a pulse matching the template returns its
+// amplitude; a pulse is found where the filter output peaks above the
+// channel's pulse threshold. That maximum sits about a sample before the
+// pulse peak, not at its onset, so the start is walked back along the leading
+// edge to the earliest sample over 10% of the peak, as in the reference.
+// Averaging over the template suppresses single-sample noise spikes. Like
+// every finder it only sees channels the front end flagged over threshold.
+// The template is held as integer weights over TEMPLATE_SCALE, so fixed-point
+// samples are filtered and compared in integers, scaled by the weight norm.
+class MatchedFilterPulseFinder : public PulseFinder {
+public:
+    explicit MatchedFilterPulseFinder(double baselineUncertainty)
+        : baselineUncertainty(baselineUncertainty), closeFixed(fixedPointCeil(baselineUncertainty)) {
+        norm = 0;
+        weightNorm = 0;
+        for (int k = 0; k < TEMPLATE_SIZE; k++) {
+            weights[k] = static_cast<double>(TEMPLATE_WEIGHTS[k]) / TEMPLATE_SCALE;
+            norm += weights[k] * weights[k];
+            weightNorm += TEMPLATE_WEIGHTS[k] * TEMPLATE_WEIGHTS[k];
+        }
+    }
+
+    const char *name() const { return "matched"; }
+
+    int findPulses(const EventWorkspace &ws, FoundPulse *out) const {
+        if (ws.fixedPoint) {
+            // filtered / norm >= threshold, with both sides times TEMPLATE_SCALE^2 and in 1/256 ADC
+            long long filtered[ADCSIZE + 1];
+            const int *wf = ws.fixedWf;
+            for (int i = 1; i <= ADCSIZE; i++) {
+                long long sum = 0;
+                for (int k = 0; k < TEMPLATE_SIZE && i + k <= ADCSIZE; k++) sum += TEMPLATE_WEIGHTS[k] * static_cast<long long>(wf[i + k]);
+                filtered[i] = sum * TEMPLATE_SCALE;
+            }
+            long long threshold = static_cast<long long>(std::ceil(ws.threshold * (1 << FIXED_POINT_SHIFT) * weightNorm));
+            return scan(ws, wf, filtered, threshold, closeFixed, FIXED_POINT_UNIT, out);
+        }
+        double filtered[ADCSIZE + 1];
+        const double *wf = ws.wf;
+        for (int i = 1; i <= ADCSIZE; i++) {
+            double sum = 0;
+            for (int k = 0; k < TEMPLATE_SIZE && i + k <= ADCSIZE; k++) sum += weights[k] * wf[i + k];
+            filtered[i] = sum / norm;
+        }
+        return scan(ws, wf, filtered, ws.threshold, baselineUncertainty, 1.0, out);
+    }
+
+private:
+    template <class Sample, class Filtered>
+    int scan(const EventWorkspace &ws, const Sample *wf, const Filtered *filtered, Filtered threshold, Sample close,
+             double unit, FoundPulse *out) const {
+        int n = 0;
+        int iBin = 1;
+        int freeBin = 1; // First bin after the previous pulse
+        while (iBin <= ADCSIZE && n < MAX_PULSES_PER_CHANNEL) {
+            if (filtered[iBin] < threshold) {
+                iBin++;
+                continue;
+            }
+            // Ride the filter output up to its local maximum, then follow the waveform to the peak and end
+            int filterPeakBin = iBin;
+            while (filterPeakBin < ADCSIZE && filtered[filterPeakBin + 1] > filtered[filterPeakBin]) filterPeakBin++;
+
+            FoundPulse &fp = out[n++];
+            fp.peakBin = filterPeakBin;
+            Sample peak = wf[filterPeakBin];
+            int endBin = filterPeakBin;
+            for (int j = filterPeakBin + 1; j <= ADCSIZE; j++) {
+                endBin = j;
+                if (wf[j] > peak) {
+                    peak = wf[j];
+                    fp.peakBin = j;
+                }
+                if (wf[j] < close) break;
+            }
+            fp.peak = peak * unit;
+
+            // Onset: earliest sample over 10% of the peak in the run before it
+            int leadBin = ws.leadingEdgeBin(fp.peakBin);
+            if (leadBin < freeBin) leadBin = freeBin;
+            fp.startBin = fp.peakBin;
+            for (int j = leadBin; j < fp.peakBin; j++) {
+                if (wf[j] > tenthOf(peak)) {
+                    fp.startBin = j;
+                    break;
+                }
+            }
+            fp.endBin = endBin;
+            fp.energy = ws.integral(fp.startBin, endBin);
+            iBin = endBin + 1;
+            freeBin = iBin;
+        }
+        return n;
+    }
+
+    static const int TEMPLATE_SIZE = 5;
+    static const int TEMPLATE_SCALE = 20;
+    static constexpr int TEMPLATE_WEIGHTS[TEMPLATE_SIZE] = {5, 20, 14, 8, 4}; // Mean PMT pulse x TEMPLATE_SCALE, 16 ns samples
+
+    double baselineUncertainty;    // Pulse closes below this (ADC)
+    int closeFixed;                // Same in fixed point
+    double weights[TEMPLATE_SIZE]; // Template, TEMPLATE_WEIGHTS / TEMPLATE_SCALE
+    double norm;                   // Sum of squared template weights
+    long long weightNorm;          // Same for the integer weights, norm x TEMPLATE_SCALE^2
+};
+
+const char *const PULSE_FINDER_NAMES[] = {"threshold", "cfd", "matched"};
+
+// Create a pulse finder by name; returns nullptr for an unknown name
+inline PulseFinder *makePulseFinder(const std::string &name, double baselineUncertainty) {
+    if (name == "threshold") return new ThresholdPulseFinder(baselineUncertainty);
+    if (name == "cfd") return new CfdPulseFinder(baselineUncertainty);
+    if (name == "matched") return new MatchedFilterPulseFinder(baselineUncertainty);
+    return nullptr;
+}
+
+// Pulse-level agreement of the fixed-point front end with the double one
+struct FixedPointComparison {
+    long channels;             // Channels over threshold in either front end
+    long countMismatches;      // Channels where the two give a different number of pulses
+    long pulses;               // Pulses compared pairwise
+    long startMismatches;      // Compared pulses starting on a different sample
+    int maxStartDeviation;     // Largest start difference (samples)
+    double maxEnergyDeviation; // Largest energy difference of compared pulses (ADC)
+
+    void reset() {
+        channels = 0;
+        countMismatches = 0;
+        pulses = 0;
+        startMismatches = 0;
+        maxStartDeviation = 0;
+        maxEnergyDeviation = 0;
+    }
+};
+
+// Run the finder on the fixed-point and the reference front-end output of the
+// first nEvents lanes and add their differences to cmp. Uses the thread's
+// workspace, so call it between events.
+template <int N>
+void comparePulsePaths(const PulseFinder &finder, const EventBatch<N> &batch, const FrontEndBatch<N> &fixed,
+                       const FrontEndBatch<N> &reference, FixedPointComparison &cmp) {
+    EventWorkspace &ws = eventWorkspace();
+    FoundPulse fixedPulses[MAX_PULSES_PER_CHANNEL];
+    FoundPulse refPulses[MAX_PULSES_PER_CHANNEL];
+    for (int lane = 0; lane < batch.nEvents; lane++) {
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            bool fixedOver = fixed.overThreshold[iChan][lane];
+            bool refOver = reference.overThreshold[iChan][lane];
+            if (!fixedOver && !refOver) continue;
+            int nFixed = 0, nRef = 0;
+            if (fixedOver) {
+                ws.loadChannel(batch, fixed, iChan, lane);
+                nFixed = finder.findPulses(ws, fixedPulses);
+            }
+            if (refOver) {
+                ws.loadChannel(batch, reference, iChan, lane);
+                nRef = finder.findPulses(ws, refPulses);
+            }
+            cmp.channels++;
+            if (nFixed != nRef) cmp.countMismatches++;
+            for (int k = 0; k < nFixed && k < nRef; k++) {
+                int startDeviation = std::abs(fixedPulses[k].startBin - refPulses[k].startBin);
+                double energyDeviation = std::fabs(fixedPulses[k].energy - refPulses[k].energy);
+                cmp.pulses++;
+                cmp.startMismatches += startDeviation != 0;
+                if (startDeviation > cmp.maxStartDeviation) cmp.maxStartDeviation = startDeviation;
+                if (energyDeviation > cmp.maxEnergyDeviation) cmp.maxEnergyDeviation = energyDeviation;
+            }
+        }
+    }
+}
+
+// Raw waveforms of one event, kept in memory for benchmarking
+struct RawEvent {
+    short adcVal[N_CHANNELS][ADCSIZE];
+    double baselineMean[N_CHANNELS];
+    double baselineRMS[N_CHANNELS];
+};
+
+// Throughput and agreement of one pulse finder against the reference
+struct PulseFinderReport {
+    std::string name;       // Algorithm name
+    double eventsPerSecond; // Front end plus pulse finding on all channels
+    long nPulses;           // Pulses found
+    double countAgreement;  // Fraction of channels with the same pulse count as the reference
+    double startAgreement;  // Fraction of matched pulses starting within one sample of the reference
+    double energyRatio;     // Mean energy / reference energy over matched pulses
+};
+
+// Run the front end and a pulse finder over preloaded events. If reference
+// results are given, compare pulse by pulse; otherwise record them.
+inline PulseFinderReport benchmarkPulseFinder(const PulseFinder &finder, const std::vector<RawEvent> &events,
+                                              const FrontEndSettings &settings,
+                                              std::vector<int> &refCounts, std::vector<FoundPulse> &refPulses) {
+    EventBatch<EVENT_BATCH_SIZE> &batch = eventBatch();
+    FrontEndBatch<EVENT_BATCH_SIZE> &fe = frontEndBatch();
+    EventWorkspace &ws = eventWorkspace();
+    bool record = refCounts.empty();
+    std::vector<int> counts(events.size() * N_CHANNELS, 0);
+    std::vector<FoundPulse> pulses;
+    pulses.reserve(record ? events.size() * 4 : refPulses.size());
+    FoundPulse found[MAX_PULSES_PER_CHANNEL];
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < events.size(); first += EVENT_BATCH_SIZE) {
+        batch.clear();
+        for (size_t i = first; i < events.size() && !batch.full(); i++) {
+            batch.add(events[i].adcVal, events[i].baselineMean, 0, 0, static_cast<int>(i));
+        }
+        runFrontEnd(batch, settings, fe);
+        for (int lane = 0; lane < batch.nEvents; lane++) {
+            for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+                if (!fe.overThreshold[iChan][lane]) continue;
+                ws.loadChannel(batch, fe, iChan, lane);
+                int nFound = finder.findPulses(ws, found);
+                counts[(first + lane) * N_CHANNELS + iChan] = nFound;
+                pulses.insert(pulses.end(), found, found + nFound);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    PulseFinderReport report;
+    report.name = finder.name();
+    report.eventsPerSecond = seconds > 0 ? events.size() / seconds : 0;
+    report.nPulses = static_cast<long>(pulses.size());
+    report.countAgreement = 1;
+    report.startAgreement = 1;
+    report.energyRatio = 1;
+    if (record) {
+        refCounts.swap(counts);
+        refPulses.swap(pulses);
+        return report;
+    }
+
+    long sameCount = 0, matched = 0, sameStart = 0;
+    double ratioSum = 0;
+    size_t iRef = 0, iCur = 0;
+    for (size_t c = 0; c < counts.size(); c++) {
+        if (counts[c] == refCounts[c]) sameCount++;
+        int nMatch = counts[c] < refCounts[c] ? counts[c] : refCounts[c];
+        for (int k = 0; k < nMatch; k++) {
+            const FoundPulse &ref = refPulses[iRef + k];
+            const FoundPulse &cur = pulses[iCur + k];
+            matched++;
+            if (std::abs(cur.startBin - ref.startBin) <= 1) sameStart++;
+            if (ref.energy != 0) ratioSum += cur.energy / ref.energy;
+        }
+        iRef += refCounts[c];
+        iCur += counts[c];
+    }
+    report.countAgreement = counts.empty() ? 1 : static_cast<double>(sameCount) / counts.size();
+    report.startAgreement = matched ? static_cast<double>(sameStart) / matched : 1;
+    report.energyRatio = matched ? ratioSum / matched : 1;
+    return report;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <TFile.h>
+#include <TTree.h>
+#include <TSystem.h>
+#include <TString.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "EventKernel.h"
+#include "PulseFinder.h"
+
+using std::cout;
+using std::endl;
+using namespace std;
+
+// Constants
+const int PULSE_THRESHOLD = 30;     // ADC threshold for pulse detection
+const int BS_UNCERTAINTY = 5;       // Baseline uncertainty (ADC)
+const int LATE_PULSE_THRESHOLD = 100; // Last-sample level for a pulse past the window (ADC)
+const int ADC_SATURATION = 16383;   // 14-bit digitizer full scale (ADC code)
+const double NOISE_THRESHOLD_SIGMAS = 6; // Noise-adaptive pulse threshold in units of baselineRMS
+const Long64_t DEFAULT_MAX_EVENTS = 100000; // Events loaded into memory per run
+
+// Compare every pulse-finding algorithm against the reference threshold
+// finder on the same events: throughput (events/s, front end included, file
+// I/O excluded) and agreement in pulse count, start sample and charge.
+// Then rerun the reference with noise-adaptive thresholds to show how many
+// pulses per event they remove.
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cout << "Usage: " << argv[0] << " <input_file> [max_events]" << endl;
+        return -1;
+    }
+    string inputFileName = argv[1];
+    Long64_t maxEvents = argc > 2 ? atoll(argv[2]) : DEFAULT_MAX_EVENTS;
+
+    if (gSystem->AccessPathName(inputFileName.c_str())) {
+        cerr << "Error: Input file " << inputFileName << " not found" << endl;
+        return -1;
+    }
+    TFile *f = TFile::Open(inputFileName.c_str());
+    if (!f || f->IsZombie()) {
+        cerr << "Error opening input file: " << inputFileName << endl;
+        return -1;
+    }
+    TTree *t = (TTree*)f->Get("tree");
+    if (!t) {
+        cerr << "Could not find tree in file: " << inputFileName << endl;
+        f->Close();
+        return -1;
+    }
+
+    Short_t adcVal[23][45];
+    Double_t baselineMean[23];
+    Double_t baselineRMS[23];
+    t->SetBranchAddress("adcVal", adcVal);
+    t->SetBranchAddress("baselineMean", baselineMean);
+    t->SetBranchAddress("baselineRMS", baselineRMS);
+
+    Long64_t nEntries = t->GetEntries();
+    if (nEntries > maxEvents) nEntries = maxEvents;
+    vector<RawEvent> events(nEntries);
+    for (Long64_t iEnt = 0; iEnt < nEntries; iEnt++) {
+        t->GetEntry(iEnt);
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+            for (int i = 0; i < ADCSIZE; i++) events[iEnt].adcVal[iChan][i] = adcVal[iChan][i];
+            events[iEnt].baselineMean[iChan] = baselineMean[iChan];
+            events[iEnt].baselineRMS[iChan] = baselineRMS[iChan];
+        }
+    }
+    f->Close();
+    cout << "Loaded " << nEntries << " events from " << inputFileName << endl;
+
+    const FrontEndSettings settings = makeFrontEndSettings(PULSE_THRESHOLD, BS_UNCERTAINTY, LATE_PULSE_THRESHOLD, ADC_SATURATION);
+    vector<int> refCounts;
+    vector<FoundPulse> refPulses;
+    cout << "Algorithm   Events/s    Pulses      Count agree  Start agree  Energy ratio\n";
+    for (const char *name : PULSE_FINDER_NAMES) {
+        PulseFinder *finder = makePulseFinder(name, BS_UNCERTAINTY);
+        PulseFinderReport r = benchmarkPulseFinder(*finder, events, settings, refCounts, refPulses);
+        cout << Form("%-10s  %10.0f  %10ld  %10.4f   %10.4f   %10.4f", r.name.c_str(), r.eventsPerSecond,
+                     r.nPulses, r.countAgreement, r.startAgreement, r.energyRatio) << endl;
+        delete finder;
+    }
+
+    // Noise-adaptive thresholds from the mean baselineRMS of the loaded run
+    double rms[N_CHANNELS] = {0};
+    for (const RawEvent &event : events) {
+        for (int iChan = 0; iChan < N_CHANNELS; iChan++) rms[iChan] += event.baselineRMS[iChan];
+    }
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) rms[iChan] /= nEntries > 0 ? nEntries : 1;
+    FrontEndSettings adaptive = settings;
+    unsigned int raised = applyNoiseThresholds(adaptive, rms, NOISE_THRESHOLD_SIGMAS);
+    cout << "\nNoise-adaptive thresholds (" << NOISE_THRESHOLD_SIGMAS << " x RMS, floor " << PULSE_THRESHOLD << " ADC):";
+    for (int iChan = 0; iChan < N_CHANNELS; iChan++) {
+        if (raised & (1u << iChan)) cout << Form(" ch%d=%.1f", iChan, adaptive.pulseThreshold[iChan]);
+    }
+    if (!raised) cout << " none raised";
+    cout << endl;
+    PulseFinder *reference = makePulseFinder(PULSE_FINDER_NAMES[0], BS_UNCERTAINTY);
+    PulseFinderReport r = benchmarkPulseFinder(*reference, events, adaptive, refCounts, refPulses);
+    double perEvent = nEntries > 0 ? 1.0 / nEntries : 0;
+    cout << Form("Pulses per event: %.3f flat, %.3f adaptive (%.0f events/s, count agreement %.4f)",
+                 refPulses.size() * perEvent, r.nPulses * perEvent, r.eventsPerSecond, r.countAgreement) << endl;
+    delete reference;
+    return 0;
+}
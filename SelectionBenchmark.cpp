@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "EventKernel.h"
+#include "EventRecord.h"
+#include "CutFlow.h"
+#include "SelectionProcessor.h"
+
+using namespace std;
+
+// Constants
+const int DEFAULT_EVENTS = 1000000;  // Synthetic events per run
+const int N_PASSES = 5;              // Timed passes per combination; the fastest is reported
+const unsigned SEED = 12345;         // Fixed, so every run sees the same events
+const double MEAN_GAP_US = 50;       // Mean time between events (µs)
+const double MUON_FRACTION = 0.05;   // Events that are through-going muons
+const double MICHEL_FRACTION = 0.3;  // Muons followed by a decay electron
+const double MUON_LIFETIME_US = 2.2; // Decay time constant (µs)
+const double PMT_HIT_THRESHOLD = 1;  // Min pulse energy for a PMT hit (p.e.)
+const char *const MUON_CUTS = "muon_veto: veto_hit == 1; muon_energy: muon_energy > 50";
+const char *const MICHEL_CUTS = "full_path: path == full; energy_min: energy >= 40; energy_max: energy <= 1000; "
+                                "multiplicity: multiplicity >= 8; veto_quiet: veto_quiet == 1; parent_muon: parents >= 1";
+
+// What the front end leaves for one event, kept compact so a million fit in memory
+struct SyntheticEvent {
+    HotEvent hot;
+    float pulseEnergy[N_PMTS][2]; // Up to two PMT pulses (p.e.), 0 if absent
+    float vetoEnergy[N_VETO_PANELS];
+    float beamIntegral;
+};
+
+vector<SyntheticEvent> makeEvents(int n) {
+    mt19937 rng(SEED);
+    uniform_real_distribution<double> uniform(0, 1);
+    exponential_distribution<double> gap(1 / MEAN_GAP_US);
+    exponential_distribution<double> decay(1 / MUON_LIFETIME_US);
+    vector<SyntheticEvent> events(n);
+    double timeUs = 0;
+    bool michelNext = false;
+    for (int i = 0; i < n; i++) {
+        SyntheticEvent &e = events[i];
+        bool muon = !michelNext && uniform(rng) < MUON_FRACTION;
+        timeUs += michelNext ? decay(rng) : gap(rng);
+        double scale = muon ? 300 : michelNext ? 25 : 4; // Mean p.e. per PMT pulse
+        double energy = 0;
+        unsigned short pmtMask = 0;
+        for (int p = 0; p < N_PMTS; p++) {
+            for (int k = 0; k < 2; k++) {
+                bool present = k == 0 ? uniform(rng) < (muon || michelNext ? 0.95 : 0.4) : uniform(rng) < 0.1;
+                e.pulseEnergy[p][k] = present ? static_cast<float>(scale * -log(1 - uniform(rng))) : 0;
+                energy += e.pulseEnergy[p][k];
+                if (e.pulseEnergy[p][k] > PMT_HIT_THRESHOLD) pmtMask |= 1u << p;
+            }
+        }
+        double side = 0, top = 0;
+        for (int v = 0; v < N_VETO_PANELS; v++) {
+            bool crossed = muon && uniform(rng) < 0.3;
+            e.vetoEnergy[v] = static_cast<float>(crossed ? 800 + 1500 * uniform(rng) : 200 * uniform(rng));
+            (v < SIDE_PANEL_CHANNELS.size() ? side : top) += e.vetoEnergy[v];
+        }
+        e.beamIntegral = static_cast<float>(uniform(rng) < 0.02 ? 2000 : 100);
+        e.hot.startNs = static_cast<long long>(timeUs * 1000);
+        e.hot.energy = static_cast<float>(energy);
+        e.hot.sideVetoEnergy = static_cast<float>(side);
+        e.hot.topVetoEnergy = static_cast<float>(top);
+        e.hot.pmtMask = pmtMask;
+        e.hot.vetoMask = 0;
+        e.hot.trigger = 2;
+        e.hot.flags = EVENT_SINGLE;
+        michelNext = muon && uniform(rng) < MICHEL_FRACTION;
+    }
+    return events;
+}
+
+// Load one event into the workspace the way the main loop leaves it
+void loadEvent(const SyntheticEvent &e, EventWorkspace &ws) {
+    for (int p = 0; p < N_PMTS; p++) {
+        int iChan = PMT_CHANNELS.first + p;
+        ws.nPulses[iChan] = 0;
+        for (int k = 0; k < 2; k++) {
+            if (e.pulseEnergy[p][k] > 0) ws.pulses[iChan][ws.nPulses[iChan]++].energy = e.pulseEnergy[p][k];
+        }
+    }
+    for (int v = 0; v < N_VETO_PANELS; v++) ws.vetoEnergy[v] = e.vetoEnergy[v];
+    ws.topVetoEnergy = e.hot.topVetoEnergy;
+}
+
+// Run every veto x multiplicity instantiation of processSelection over the
+// same synthetic events with the "final" thresholds and cuts: throughput of
+// the selection step alone (workspace loading included, reconstruction
+// excluded) and the muons and Michels each convention finds.
+int main(int argc, char *argv[]) {
+    int nEvents = argc > 1 ? atoi(argv[1]) : DEFAULT_EVENTS;
+    if (nEvents <= 0) {
+        cout << "Usage: " << argv[0] << " [events]" << endl;
+        return -1;
+    }
+    vector<SyntheticEvent> events = makeEvents(nEvents);
+    cout << "Generated " << nEvents << " events (seed " << SEED << ")" << endl;
+
+    static EventWorkspace ws;
+    ws.reset();
+    double pmtHitThreshold[N_PMTS];
+    for (int p = 0; p < N_PMTS; p++) pmtHitThreshold[p] = PMT_HIT_THRESHOLD;
+
+    const char *const vetoNames[] = {PanelVeto::name(), SipmVeto::name()};
+    const char *const multiplicityNames[] = {HitPmtMultiplicity::name(), PulseMultiplicity::name()};
+    cout << "Veto    Multiplicity  Events/s      Muons     Michels\n";
+    for (const char *veto : vetoNames) {
+        for (const char *multiplicity : multiplicityNames) {
+            SelectionConfig cfg = {"bench", 1200, veto, multiplicity, MUON_CUTS, MICHEL_CUTS, 400, 0.8, 16, 16,
+                                   {750, 950, 1200, 1375, 525, 700, 700, 500, 450, 450}, 450,
+                                   200, 160, 1000, 2000, "dt"};
+            double best = 0;
+            long muons = 0, michels = 0;
+            for (int pass = 0; pass < N_PASSES; pass++) {
+                SelectionCore sel(cfg);
+                string error;
+                if (!sel.process || !sel.compileCuts(error)) {
+                    cerr << "Error in selection " << veto << "/" << multiplicity << ": " << error << endl;
+                    return -1;
+                }
+                muons = 0;
+                michels = 0;
+                auto begin = chrono::steady_clock::now();
+                for (const SyntheticEvent &e : events) {
+                    loadEvent(e, ws);
+                    EventInputs inputs = {&ws, pmtHitThreshold, e.beamIntegral, false, PATH_FULL};
+                    SelectionResult r = sel.process(sel, e.hot, inputs);
+                    muons += r.muon;
+                    michels += r.michel;
+                }
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+                if (seconds > 0 && nEvents / seconds > best) best = nEvents / seconds;
+            }
+            char line[80];
+            snprintf(line, sizeof(line), "%-6s  %-12s  %10.0f  %9ld  %10ld", veto, multiplicity, best, muons, michels);
+            cout << line << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef SELECTION_CONFIG_H
+#define SELECTION_CONFIG_H
+
+#include "EventKernel.h"
+#include <string>
+#include <vector>
+
+// One set of muon and Michel cuts. The variant programs differ only in
+// these values, so several sets can be evaluated side by side on the same
+// reconstructed events.
+struct SelectionConfig {
+    std::string name;
+    double ev61Threshold;                 // Beam on if the beam channel integral > this (ADC)
+    std::string vetoConvention;           // "panels" or "sipm" (see SelectionProcessor)
+    std::string multiplicity;             // "pmts" or "pulses"
+    std::string muonCuts;                 // Muon cuts in order (see CutFlow)
+    std::string michelCuts;               // Michel cuts in order; "parents" counts muons in the dt window
+    double michelEnergyMaxDt;             // Max PMT energy for dt plots (p.e.)
+    double michelDtMin;                   // Min time after muon for Michel (µs)
+    double michelDtMax;                   // Max time after muon for Michel (µs)
+    double muonDeadTime;                  // Dead time after each muon, for live time (µs)
+    double panelThreshold[N_VETO_PANELS]; // Veto panel hit thresholds by panel slot (ADC)
+    double topSumThreshold;               // Summed top panels (ADC)
+    int michelEnergyBins;                 // h_michel_energy bins over 0-800 p.e.
+    int dtBins;                           // h_dt_michel bins over 0-michelDtMax
+    double energyVsDtMaxDt;               // h_energy_vs_dt x range (µs)
+    double energyVsDtMaxEnergy;           // h_energy_vs_dt y range (p.e.)
+    std::string energyVsDtFill;           // Events in h_energy_vs_dt: "dt", "michel" or "all" (see ENERGY_VS_DT_*)
+};
+
+// Which events fill h_energy_vs_dt; the variant programs differ here
+const int ENERGY_VS_DT_DT = 0;     // Michels that also fill h_dt_michel (energy <= michelEnergyMaxDt)
+const int ENERGY_VS_DT_MICHEL = 1; // Every Michel
+const int ENERGY_VS_DT_ALL = 2;    // Every event, against the latest muon
+const char *const ENERGY_VS_DT_FILL_NAMES[] = {"dt", "michel", "all"};
+
+// ENERGY_VS_DT_* code of a fill rule name, -1 if unknown
+inline int energyVsDtFillCode(const std::string &name) {
+    for (int i = 0; i < 3; i++) {
+        if (name == ENERGY_VS_DT_FILL_NAMES[i]) return i;
+    }
+    return -1;
+}
+
+// Delayed-coincidence window searched after the muons of every selection
+// besides the Michel window, e.g. for neutron captures. All windows of a
+// selection are served by its one muon window in the same pass.
+struct DelayedWindowConfig {
+    std::string name;
+    std::string cuts; // Delayed-event cuts in order (see CutFlow); "parents" counts muons in this window
+    double dtMin;     // Min time after muon (µs)
+    double dtMax;     // Max time after muon (µs)
+    int energyBins;   // h_delayed_energy bins over 0-maxEnergy
+    double maxEnergy; // h_delayed_energy range (p.e.)
+    int dtBins;       // h_delayed_dt bins over 0-dtMax
+};
+
+const int MAX_DELAYED_WINDOWS = 8; // Windows per job; one bit each in SelectionResult::delayedMask
+
+// Index of the named configuration in a table, -1 if absent
+template <class Config>
+int findConfig(const std::vector<Config> &table, const std::string &name) {
+    for (size_t i = 0; i < table.size(); i++) {
+        if (table[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+#endif
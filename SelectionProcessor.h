@@ -0,0 +1,211 @@
+#ifndef SELECTION_PROCESSOR_H
+#define SELECTION_PROCESSOR_H
+
+#include "EventKernel.h"
+#include "EventRecord.h"
+#include "MuonCorrelator.h"
+#include "SelectionConfig.h"
+#include "CutFlow.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Veto conventions of the variant programs. Both reject a Michel if any
+// panel is over its own threshold; they differ in what makes a muon.
+
+// Side panels singly or the summed top panels (panel_thresholds + top_sum_threshold)
+struct PanelVeto {
+    static const char *name() { return "panels"; }
+    static bool hit(unsigned short vetoMask) { return (vetoMask & (SIDE_PANEL_BITS | TOP_SUM_BIT)) != 0; }
+    static bool quiet(unsigned short vetoMask) { return (vetoMask & ALL_PANEL_BITS) == 0; }
+};
+
+// Any of the ten panels singly (SIPM_THRESHOLDS)
+struct SipmVeto {
+    static const char *name() { return "sipm"; }
+    static bool hit(unsigned short vetoMask) { return (vetoMask & ALL_PANEL_BITS) != 0; }
+    static bool quiet(unsigned short vetoMask) { return (vetoMask & ALL_PANEL_BITS) == 0; }
+};
+
+// Multiplicity conventions
+
+// PMTs with a pulse at or over their hit threshold, each counted once
+struct HitPmtMultiplicity {
+    static const char *name() { return "pmts"; }
+    static int count(const HotEvent &ev, const EventWorkspace &, const double *) { return ev.multiplicity(); }
+};
+
+// PMT pulses over the hit threshold; a PMT with two such pulses counts twice
+struct PulseMultiplicity {
+    static const char *name() { return "pulses"; }
+    static int count(const HotEvent &, const EventWorkspace &ws, const double *pmtHitThreshold) {
+        int n = 0;
+        for (int iChan = PMT_CHANNELS.first; iChan < PMT_CHANNELS.end; iChan++) {
+            double threshold = pmtHitThreshold[CHANNEL_LAYOUT[iChan].slot];
+            for (int k = 0; k < ws.nPulses[iChan]; k++) n += ws.pulses[iChan][k].energy > threshold;
+        }
+        return n;
+    }
+};
+
+// Reconstructed quantities every selection reads besides the hot record
+struct EventInputs {
+    const EventWorkspace *ws;
+    const double *pmtHitThreshold; // By PMT (p.e.)
+    double beamIntegral;           // Beam channel window integral (ADC)
+    bool pulseAtEnd;               // Enough PMT pulses run past the window
+    int path;                      // PATH_*
+};
+
+// Outcome of one selection for one event
+struct SelectionResult {
+    HotEvent event;     // With this selection's veto mask and EVENT_* flags
+    int multiplicity;   // Under this selection's convention
+    bool muon;
+    bool michel;
+    MuonEntry *parent;  // Nearest muon in the dt window, null if none
+    int nParents;       // Muons in the dt window
+    unsigned delayedMask; // Bit w set if the event passes delayed window w
+    MuonEntry *delayedParent[MAX_DELAYED_WINDOWS]; // Nearest muon in window w, null if none
+};
+
+// A delayed window as the processor runs it
+struct DelayedWindow {
+    const DelayedWindowConfig *config;
+    long long dtMinNs;
+    long long dtMaxNs;
+    CutFlow cuts;       // Compiled from the configuration, with per-run counts
+};
+
+struct SelectionCore;
+typedef SelectionResult (*SelectionProcessor)(SelectionCore &sel, const HotEvent &ev, const EventInputs &in);
+
+// Selection state the processor updates: muon window and compiled cuts
+struct SelectionCore {
+    const SelectionConfig *config;
+    MuonWindow muonWindow;    // Recent muons passing this configuration's muon cuts
+    long long dtMinNs;        // Michel window (ns)
+    long long dtMaxNs;
+    CutFlow muonCuts;         // Compiled from the configuration, with per-run counts
+    CutFlow michelCuts;
+    SelectionProcessor process; // Instantiation for the configuration's conventions
+    std::vector<DelayedWindow> windows; // Searched after the Michel window, sharing muonWindow
+
+    explicit SelectionCore(const SelectionConfig &cfg);
+
+    // Search a delayed window too; call before compileCuts and the first event
+    void addWindow(const DelayedWindowConfig &w) {
+        DelayedWindow window;
+        window.config = &w;
+        window.dtMinNs = static_cast<long long>(std::ceil(w.dtMin * 1000));
+        window.dtMaxNs = static_cast<long long>(std::floor(w.dtMax * 1000));
+        windows.push_back(window);
+        muonWindow.extend(static_cast<long long>(w.dtMax * 1000));
+    }
+
+    // Compile the cut lists; false and a message if one does not parse
+    bool compileCuts(std::string &error) {
+        if (!muonCuts.compile(config->muonCuts, error)) {
+            error = "muon cuts: " + error;
+            return false;
+        }
+        if (!michelCuts.compile(config->michelCuts, error)) {
+            error = "Michel cuts: " + error;
+            return false;
+        }
+        if (!michelCuts.requiresAtLeast(CUT_VAR_PARENTS, 1)) {
+            error = "Michel cuts must require parents >= 1";
+            return false;
+        }
+        for (DelayedWindow &window : windows) {
+            if (!window.cuts.compile(window.config->cuts, error)) {
+                error = "window " + window.config->name + " cuts: " + error;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// One selection step for one event: veto mask and beam flag under this
+// selection's thresholds, muon tagging, then the Michel search. The veto
+// and multiplicity conventions are template parameters, so each of the
+// four combinations compiles to its own straight-line code; the choice is
+// made once per selection, not per event.
+template <class Veto, class Multiplicity>
+SelectionResult processSelection(SelectionCore &sel, const HotEvent &ev, const EventInputs &in) {
+    const SelectionConfig &cfg = *sel.config;
+    SelectionResult r;
+    r.event = ev;
+    r.event.vetoMask = vetoHitMask(in.ws->vetoEnergy, cfg.panelThreshold, in.ws->topVetoEnergy, cfg.topSumThreshold);
+    r.event.flags |= in.beamIntegral > cfg.ev61Threshold ? EVENT_BEAM : 0;
+    r.multiplicity = Multiplicity::count(ev, *in.ws, in.pmtHitThreshold);
+    sel.muonWindow.expire(ev.startNs);
+
+    double vars[N_CUT_VARS];
+    vars[CUT_VAR_ENERGY] = ev.energy;
+    vars[CUT_VAR_MUON_ENERGY] = in.pulseAtEnd ? 2.0 * ev.energy : ev.energy;
+    vars[CUT_VAR_MULTIPLICITY] = r.multiplicity;
+    vars[CUT_VAR_VETO] = r.event.vetoMask;
+    vars[CUT_VAR_VETO_HIT] = Veto::hit(r.event.vetoMask);
+    vars[CUT_VAR_VETO_QUIET] = Veto::quiet(r.event.vetoMask);
+    vars[CUT_VAR_PATH] = in.path;
+    vars[CUT_VAR_TRIGGER] = ev.trigger;
+
+    r.muon = sel.muonCuts.apply(vars);
+    r.parent = nullptr;
+    r.nParents = 0;
+    r.michel = false;
+    r.delayedMask = 0;
+    if (r.muon) {
+        r.event.flags |= EVENT_MUON;
+        sel.muonWindow.push(ev.startNs, ev.energy, r.event.vetoMask);
+        // A muon is never a Michel or delayed candidate, even if the veto
+        // convention also calls it quiet (e.g. only the top sum fired), so
+        // the Michel and window cut flows count non-muon events only
+        return r;
+    }
+
+    // The parent is any muon in the dt window, the nearest one for the single-pair plots
+    r.nParents = sel.muonWindow.forEachParent(ev.startNs, sel.dtMinNs, sel.dtMaxNs,
+                                              [&](MuonEntry &muon, long long) {
+                                                  if (!r.parent) r.parent = &muon;
+                                              });
+    vars[CUT_VAR_PARENTS] = r.nParents;
+    r.michel = sel.michelCuts.apply(vars);
+    if (r.michel) r.event.flags |= EVENT_MICHEL;
+
+    // Delayed windows walk the same muons, each with its own range and cuts
+    for (size_t w = 0; w < sel.windows.size(); w++) {
+        DelayedWindow &window = sel.windows[w];
+        MuonEntry *parent = nullptr;
+        vars[CUT_VAR_PARENTS] = sel.muonWindow.forEachParent(ev.startNs, window.dtMinNs, window.dtMaxNs,
+                                                             [&](MuonEntry &muon, long long) {
+                                                                 if (!parent) parent = &muon;
+                                                             });
+        r.delayedParent[w] = parent;
+        r.delayedMask |= static_cast<unsigned>(window.cuts.apply(vars)) << w;
+    }
+    return r;
+}
+
+// Instantiation for the named conventions, null if either is unknown
+inline SelectionProcessor selectionProcessor(const std::string &veto, const std::string &multiplicity) {
+    bool panels = veto == PanelVeto::name();
+    bool sipm = veto == SipmVeto::name();
+    bool pmts = multiplicity == HitPmtMultiplicity::name();
+    bool pulses = multiplicity == PulseMultiplicity::name();
+    if (panels && pmts) return &processSelection<PanelVeto, HitPmtMultiplicity>;
+    if (panels && pulses) return &processSelection<PanelVeto, PulseMultiplicity>;
+    if (sipm && pmts) return &processSelection<SipmVeto, HitPmtMultiplicity>;
+    if (sipm && pulses) return &processSelection<SipmVeto, PulseMultiplicity>;
+    return nullptr;
+}
+
+inline SelectionCore::SelectionCore(const SelectionConfig &cfg)
+    : config(&cfg), muonWindow(static_cast<long long>(cfg.michelDtMax * 1000)),
+      dtMinNs(static_cast<long long>(std::ceil(cfg.michelDtMin * 1000))),
+      dtMaxNs(static_cast<long long>(std::floor(cfg.michelDtMax * 1000))),
+      process(selectionProcessor(cfg.vetoConvention, cfg.multiplicity)) {}
+
+#endif
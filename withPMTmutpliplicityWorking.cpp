@@ -390,7 +390,7 @@ int main(int argc, char *argv[]) {
             bool pulse_at_end = false;  // Flag for pulses at end of waveform
             int pulse_at_end_count = 0; // Counter for pulses at end
             std::vector<double> sipm_energies(10, 0); // Channels 12-21
-            bool pmt_channel_hit[12] = {false}; // Track PMT hits
+            unsigned int pmt_hit_mask = 0; // Bit i set if PMT i has a pulse over threshold
 
             // Process each channel
             for (int iChan = 0; iChan < 23; iChan++) {
@@ -457,9 +457,7 @@ int main(int argc, char *argv[]) {
                                 all_chan_energy.push_back(pt.energy);
                                 
                                 // Check Michel threshold for PMTs
-                                if (pt.energy >= PMT_THRESHOLD_MICHEL) {
-                                    pmt_channel_hit[iChan] = true;  // Mark PMT hit
-                                }
+                                pmt_hit_mask |= static_cast<unsigned int>(pt.energy >= PMT_THRESHOLD_MICHEL) << iChan;
                             }
                             pulses_temp.push_back(pt);
                             // Reset pulse variables
@@ -492,11 +490,7 @@ int main(int argc, char *argv[]) {
             }
 
             // Count PMT channels with at least 1 p.e.
-            for (int pmt = 0; pmt < 12; pmt++) {
-                if (pmt_channel_hit[pmt]) {
-                    p.number++;
-                }
-            }
+            p.number = __builtin_popcount(pmt_hit_mask);
 
             // Aggregate pulse properties
             p.start += mostFrequent(all_chan_start);